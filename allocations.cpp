@@ -0,0 +1,59 @@
+#include "allocations.h"
+
+//=============================================
+// @filename     allocations.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdlib>
+#include <new>
+
+/**
+ * Replacement of the global operators new and delete, which count the allocations of each
+ * thread in Allocations. This file is only linked with TRACK_ALLOCATIONS.
+ */
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Allocate with malloc, and count the allocation.
+ * @return [Pointer to the block, or null if malloc failed.]
+ */
+static inline void* tracked_malloc( std::size_t size )
+{
+	uint64_t *values = Allocations::shard();
+	++values[0]; values[1] += size;
+
+	return std::malloc( size ? size : 1 );
+}
+
+void* operator new( std::size_t size )
+{
+	void *p = tracked_malloc(size);
+	if ( !p ) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[]( std::size_t size )
+{
+	void *p = tracked_malloc(size);
+	if ( !p ) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept { return tracked_malloc(size); }
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept { return tracked_malloc(size); }
+
+void operator delete( void *p ) noexcept { std::free(p); }
+void operator delete[]( void *p ) noexcept { std::free(p); }
+void operator delete( void *p, const std::nothrow_t& ) noexcept { std::free(p); }
+void operator delete[]( void *p, const std::nothrow_t& ) noexcept { std::free(p); }
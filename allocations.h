@@ -0,0 +1,71 @@
+#ifndef __ALLOCATIONS__
+#define __ALLOCATIONS__
+
+//=============================================
+// @filename     allocations.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdint>
+#include "counters.h"
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Heap allocations of the calling thread.
+ * Tracking is opt-in: the global operator new is only replaced when allocations.cpp is 
+ * linked, ie. when building with TRACK_ALLOCATIONS (make TRACK_ALLOCATIONS=1). Otherwise 
+ * nothing is counted, and the counts stay at zero.
+ */
+struct Allocations
+{
+	// Number of allocations and of bytes allocated by the calling thread (zero-initialized)
+	static inline uint64_t* shard()
+	{
+		static thread_local uint64_t values[2];
+		return values;
+	}
+
+	static inline uint64_t count() { return shard()[0]; }
+	static inline uint64_t bytes() { return shard()[1]; }
+
+	// Was the tracker built in?
+	static inline bool tracking()
+	{
+#ifdef TRACK_ALLOCATIONS
+		return true;
+#else
+		return false;
+#endif
+	}
+};
+
+
+
+/**
+ * Allocations of a section of code, added to the counters of a phase (see CounterId).
+ */
+struct AllocationSection
+{
+	uint64_t count, bytes;
+
+	inline void start() { count = Allocations::count(); bytes = Allocations::bytes(); }
+	inline bool stop( const CounterId& allocations, const CounterId& allocated_bytes )
+	{
+		const uint64_t n = Allocations::count() - count;
+		Counters::add( allocations, n );
+		Counters::add( allocated_bytes, Allocations::bytes() - bytes );
+		return n > 0;
+	}
+};
+
+#endif
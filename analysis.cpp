@@ -0,0 +1,383 @@
+#include "analysis.h"
+
+//=============================================
+// @filename     analysis.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [record_plan Record the shot sequence of a hunter.]
+ * @param chuck     [A hunter, already set on the forest.]
+ * @param max_shots [Max length of the plan.]
+ * @param plan      [Output shot sequence (without the final -1 if Chuck gives up).]
+ */
+void record_plan( ChuckInterface *chuck, const unsigned& max_shots, plan_type& plan )
+{
+	plan.clear(); chuck->restart();
+
+	for ( int shot; plan.size() < max_shots && (shot = chuck->shoot()) >= 0; ) 
+		plan.push_back(shot);
+
+	// Leave the hunter ready for a new hunt
+	chuck->restart();
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [PlanVerifier::set_forest Build the adjacency bitsets.]
+ * @param  forest [Any forest.]
+ * @return        [Initialization success.]
+ */
+bool PlanVerifier::set_forest( const Forest& forest )
+{
+	// Safety check
+	if ( !forest ) return false;
+
+	n_trees = forest.size();
+	n_words = (n_trees + 63) >> 6;
+
+	// Get forest information
+	const Forest::vector_type& neighbors = forest.get_neighbors();
+	const Forest::array_type&  degrees   = forest.get_degrees();
+	const Forest::array_type&  strides   = forest.get_strides();
+
+	// One row of n_words per tree
+	adjacency.assign( n_trees*n_words, 0 );
+	for ( unsigned t = 0; t < n_trees; ++t )
+	for ( unsigned d = 0; d < degrees[t]; ++d )
+	{
+		const unsigned u = neighbors[ strides[t] + d ];
+		adjacency[ t*n_words + (u >> 6) ] |= uint64_t(1) << (u & 63);
+	}
+
+	support.resize(n_words);
+	next.resize(n_words);
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [PlanVerifier::verify Propagate the set of possible positions of Bob through a plan.]
+ * @param plan   [Shot sequence.]
+ * @param report [Output verdict.]
+ */
+void PlanVerifier::verify( const plan_type& plan, VerificationReport& report )
+{
+	// Bob can be anywhere
+	std::fill( support.begin(), support.end(), ~uint64_t(0) );
+	if ( n_trees & 63 ) support.back() = (uint64_t(1) << (n_trees & 63)) - 1;
+
+	report.guaranteed = false;
+	report.worst_case = 0;
+
+	for ( unsigned k = 0; k < plan.size(); ++k )
+	{
+		// Shoot
+		const unsigned shot = plan[k];
+		support[ shot >> 6 ] &= ~(uint64_t(1) << (shot & 63));
+
+		// Bob is necessarily dead
+		uint64_t any = 0;
+		for ( unsigned w = 0; w < n_words; ++w ) any |= support[w];
+		if ( !any ) 
+		{
+			report.guaranteed = true;
+			report.worst_case = k+1;
+			report.residual   = 0;
+			return;
+		}
+
+		// Jump: union of the neighborhoods of the possible positions
+		std::fill( next.begin(), next.end(), 0 );
+		for ( unsigned w = 0; w < n_words; ++w )
+		for ( uint64_t s = support[w]; s; s &= s-1 )
+		{
+			const uint64_t *row = &adjacency[ ((w << 6) + __builtin_ctzll(s)) * n_words ];
+			for ( unsigned v = 0; v < n_words; ++v ) next[v] |= row[v];
+		}
+
+		support.swap(next);
+	}
+
+	// Count remaining possible positions
+	report.residual = 0;
+	for ( unsigned w = 0; w < n_words; ++w ) report.residual += __builtin_popcountll(support[w]);
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [VerificationStatistics::clear Reset all counts.]
+ */
+void VerificationStatistics::clear()
+{
+	n_instances = n_guaranteed = worst_max = 0;
+	worst_min = std::numeric_limits<unsigned>::max();
+	worst_average = 0.0;
+}
+
+
+
+/**
+ * [VerificationStatistics::process Account for the verification of one plan.]
+ * @param report [Output of PlanVerifier::verify.]
+ */
+void VerificationStatistics::process( const VerificationReport& report )
+{
+	++n_instances;
+	if ( !report.guaranteed ) return;
+
+	// Update average, min and max worst-case number of shots
+	worst_average = (n_guaranteed*worst_average + report.worst_case) / (n_guaranteed+1);
+	if ( report.worst_case < worst_min ) worst_min = report.worst_case;
+	if ( report.worst_case > worst_max ) worst_max = report.worst_case;
+
+	++n_guaranteed;
+}
+
+
+
+/**
+ * [VerificationStatistics::print Display contents on stdout.]
+ * @param name [Name of the corresponding hunter.]
+ */
+void VerificationStatistics::print( const char* name ) const
+{
+	printf("%s's plans verification (%u instances):\n", name, n_instances);
+	printf("\t- Guaranteed kills=%u (%.2f%%)\n", n_guaranteed, n_instances ? 100.0*n_guaranteed/n_instances : 0.0);
+	if ( n_guaranteed )
+	printf("\t- Worst-case shots: min=%u, max=%u, avg=%.5f\n", worst_min, worst_max, worst_average);
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+
+/**
+ * [PlanEvaluator::set_forest Build the transition weights.]
+ * @param  forest [Any forest.]
+ * @return        [Initialization success.]
+ */
+bool PlanEvaluator::set_forest( const Forest& forest )
+{
+	// Safety check
+	if ( !forest ) return false;
+
+	n_trees = forest.size();
+
+	// Get forest information
+	const Forest::vector_type& F_neighbors = forest.get_neighbors();
+	const Forest::array_type&  degrees     = forest.get_degrees();
+	const Forest::array_type&  F_strides   = forest.get_strides();
+
+	// Copy adjacency
+	neighbors.assign( F_neighbors.begin(), F_neighbors.end() );
+	strides.assign( &F_strides[0], &F_strides[0] + n_trees+1 );
+
+	// Probabilities of the jumps into and out of each tree
+	to_weights.resize( neighbors.size() );
+	from_weights.resize( neighbors.size() );
+
+	if ( forest.weighted() )
+	{
+		const std::vector<double>& jumps   = forest.get_jumps();
+		const Forest::vector_type& reverse = forest.get_reverse();
+
+		for ( unsigned e = 0; e < neighbors.size(); ++e )
+		{
+			to_weights[e]   = jumps[ reverse[e] ];
+			from_weights[e] = jumps[e];
+		}
+	}
+	else for ( unsigned t = 0; t < n_trees; ++t )
+	for ( unsigned e = strides[t]; e < strides[t+1]; ++e )
+	{
+		to_weights[e]   = 1.0 / degrees[ neighbors[e] ];
+		from_weights[e] = 1.0 / degrees[t];
+	}
+
+	// Allocate distributions
+	pi.resize(n_trees); pi_next.resize(n_trees);
+	survival.resize(n_trees); survival_next.resize(n_trees);
+	shots.resize(n_trees); shots_next.resize(n_trees);
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [PlanEvaluator::evaluate Compute the exact capture-time distribution of a plan.]
+ * @param plan   [Shot sequence.]
+ * @param report [Output distribution.]
+ */
+void PlanEvaluator::evaluate( const plan_type& plan, CaptureReport& report )
+{
+	const unsigned K = plan.size();
+
+	// Forward pass: distribution of Bob's position, starting uniform
+	std::fill( pi.begin(), pi.end(), 1.0/n_trees );
+	report.tail.resize(K);
+
+	double alive = 1.0, mean = 0.0;
+	for ( unsigned k = 0; k < K; ++k )
+	{
+		// Shoot
+		const double killed = pi[ plan[k] ]; pi[ plan[k] ] = 0.0;
+		mean += (k+1) * killed;
+		report.tail[k] = (alive -= killed);
+
+		// Jump
+		for ( unsigned t = 0; t < n_trees; ++t )
+		{
+			double p = 0.0;
+			for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) 
+				p += pi[ neighbors[e] ] * to_weights[e];
+			pi_next[t] = p;
+		}
+		pi.swap(pi_next);
+	}
+
+	report.capture = 1.0 - alive;
+	report.mean    = report.capture > 0.0 ? mean / report.capture : 0.0;
+
+	// Backward pass: from each tree at shot k, probability to survive until the end of 
+	// the plan, and expected number of remaining shots times the indicator of capture.
+	std::fill( survival.begin(), survival.end(), 1.0 );
+	std::fill( shots.begin(), shots.end(), 0.0 );
+
+	for ( unsigned k = K; k-- > 0; )
+	{
+		for ( unsigned t = 0; t < n_trees; ++t )
+		{
+			double s = 0.0, r = 0.0;
+			for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) 
+			{
+				s += from_weights[e] * survival[ neighbors[e] ];
+				r += from_weights[e] * (shots[ neighbors[e] ] + 1.0 - survival[ neighbors[e] ]);
+			}
+
+			survival_next[t] = s;
+			shots_next[t]    = r;
+		}
+
+		// Shot tree
+		survival_next[ plan[k] ] = 0.0;
+		shots_next[ plan[k] ]    = 1.0;
+
+		survival.swap(survival_next);
+		shots.swap(shots_next);
+	}
+
+	// Conditional expectations for each start tree
+	report.per_start.resize(n_trees);
+	for ( unsigned t = 0; t < n_trees; ++t ) 
+		report.per_start[t] = survival[t] < 1.0 ? shots[t] / (1.0 - survival[t]) : 0.0;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [EvaluationStatistics::clear Reset all members.]
+ * @param horizon [Length of the averaged tail (max length of the plans).]
+ */
+void EvaluationStatistics::clear( const unsigned& horizon )
+{
+	n_instances = n_captured = 0;
+	capture = mean = 0.0;
+	tail.assign( horizon, 0.0 );
+}
+
+
+
+/**
+ * [EvaluationStatistics::process Account for the evaluation of one plan.]
+ * @param report [Output of PlanEvaluator::evaluate.]
+ */
+void EvaluationStatistics::process( const CaptureReport& report )
+{
+	// Average capture probability
+	capture = (n_instances*capture + report.capture) / (n_instances+1);
+
+	// Sum tails (plans shorter than the horizon don't capture Bob anymore)
+	const unsigned K = report.tail.size();
+	const double last = K ? report.tail.back() : 1.0;
+
+	for ( unsigned k = 0; k < tail.size(); ++k ) tail[k] += k < K ? report.tail[k] : last;
+
+	++n_instances;
+
+	// Average expected capture time, among plans which can capture Bob
+	if ( report.capture <= 0.0 ) return;
+
+	mean = (n_captured*mean + report.mean) / (n_captured+1);
+	++n_captured;
+}
+
+
+
+/**
+ * [EvaluationStatistics::quantile Quantile of the capture time on a random forest.]
+ * @param  q [Probability in (0,1).]
+ * @return   [Smallest k such that P(T <= k) >= q, or 0 if the plans are too short.]
+ */
+unsigned EvaluationStatistics::quantile( const double& q ) const
+{
+	for ( unsigned k = 0; k < tail.size(); ++k ) 
+		if ( tail[k] <= (1.0-q) * n_instances ) return k+1;
+	return 0;
+}
+
+
+
+/**
+ * [EvaluationStatistics::print Display contents on stdout.]
+ * @param name [Name of the corresponding hunter.]
+ */
+void EvaluationStatistics::print( const char* name ) const
+{
+	printf("%s's exact capture time (%u instances):\n", name, n_instances);
+	printf("\t- Capture probability=%.5f%%\n", 100*capture);
+	printf("\t- Avg=%.5f (given capture)\n", mean);
+	printf("\t- P50=%u, P90=%u, P99=%u (0 if beyond the plans)\n", quantile(0.5), quantile(0.9), quantile(0.99));
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
\ No newline at end of file
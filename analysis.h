@@ -0,0 +1,154 @@
+#ifndef __ANALYSIS__
+#define __ANALYSIS__
+
+//=============================================
+// @filename     analysis.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include "forest.h"
+#include "chuck.h"
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Hunters don't get any feedback from the hunt, so their plans are oblivious: 
+ * the shot sequence only depends on the forest. This records the first shots 
+ * of a hunter (after set_forest), stopping early if the hunter gives up.
+ */
+typedef std::vector<int> plan_type;
+
+void record_plan( ChuckInterface *chuck, const unsigned& max_shots, plan_type& plan );
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Exact worst-case analysis of a shot sequence.
+ *
+ * The set of possible positions of Bob is a bitset, which starts full. At each shot, 
+ * the shot tree is removed from the set, and the set is replaced by the union of the
+ * neighborhoods of its elements. The plan guarantees a kill iff the set becomes empty,
+ * and the worst-case number of shots is the index of the shot that empties it.
+ */
+struct VerificationReport
+{
+	bool guaranteed; 
+	unsigned worst_case; // number of shots needed in the worst case, if guaranteed
+	unsigned residual;   // size of the set of possible positions at the end of the plan
+};
+
+class PlanVerifier
+{
+public:
+
+	// Build adjacency bitsets from the forest
+	bool set_forest( const Forest& forest );
+
+	// Propagate the set of possible positions through the plan
+	void verify( const plan_type& plan, VerificationReport& report );
+
+private:
+
+	// Members
+	// 
+	std::vector<uint64_t> adjacency, support, next;
+	unsigned n_trees, n_words;
+};
+
+
+
+/**
+ * Aggregate verification reports over several instances.
+ */
+struct VerificationStatistics
+{
+	unsigned n_instances, n_guaranteed, worst_min, worst_max;
+	double worst_average;
+
+	void clear();
+	void process( const VerificationReport& report );
+	void print( const char* name = "Unknown" ) const;
+};
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Exact capture-time distribution of a shot sequence against a random Bob.
+ *
+ * Bob starts uniformly at random, and jumps to a neighbor after each shot, uniformly
+ * or with the weights of the forest (same law as Forest::random_neighbor). The 
+ * distribution of his position is propagated forward, with the shot tree zeroed at each
+ * round, which gives the law of the capture time T (in shots) up to the length K of the
+ * plan. A backward pass over the same plan gives the expectations conditioned on each 
+ * start tree. Each pass is one sparse matrix-vector product per shot, ie O(K m).
+ */
+struct CaptureReport
+{
+	double capture;   // P(T <= K)
+	double mean;      // E[T | T <= K]
+
+	std::vector<double> tail;      // tail[k] = P(T > k+1), for k < K
+	std::vector<double> per_start; // E[T | T <= K, Bob starts in tree t]
+};
+
+class PlanEvaluator
+{
+public:
+
+	// Build the transition weights from the forest
+	bool set_forest( const Forest& forest );
+
+	// Compute the capture-time distribution of a plan
+	void evaluate( const plan_type& plan, CaptureReport& report );
+
+private:
+
+	// Members
+	// 
+	std::vector<unsigned> neighbors, strides;
+	std::vector<double> to_weights, from_weights;   // P(neighbor -> t), P(t -> neighbor)
+	std::vector<double> pi, pi_next, survival, survival_next, shots, shots_next;
+
+	unsigned n_trees;
+};
+
+
+
+/**
+ * Aggregate capture reports over several instances.
+ * The tails are averaged, ie they describe the capture time on a random forest.
+ */
+struct EvaluationStatistics
+{
+	unsigned n_instances, n_captured;
+	double capture, mean;
+	std::vector<double> tail; // summed over instances
+
+	void clear( const unsigned& horizon = 0 );
+	void process( const CaptureReport& report );
+	unsigned quantile( const double& q ) const;
+	void print( const char* name = "Unknown" ) const;
+};
+
+#endif
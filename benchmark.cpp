@@ -1,5 +1,9 @@
 #include "benchmark.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
 //=============================================
 // @filename     benchmark.cpp
 // @date         April 1st 2013
@@ -18,18 +22,19 @@
 
 /**
  * [JumpingMonkeyInstance::setup Generate a new forest and put Bob in it.]
- * @param n_trees [Number of trees in the forest.]
+ * @param n_trees   [Number of trees in the forest.]
+ * @param generator [Random graph model of the forest.]
+ * @param jumps     [Law of Bob's jumps.]
  */
-void JumpingMonkeyInstance::setup( const unsigned& n_trees )
+void JumpingMonkeyInstance::setup( const unsigned& n_trees, const ForestGenerator& generator, 
+	const JumpModel& jumps )
 {
 	// Generate new forest
-	forest.generate(n_trees);
-
-	// Create uniform distribution
-	std::uniform_int_distribution<unsigned> U( 0, n_trees-1 );
+	forest.generate(n_trees,generator);
+	forest.generate_jumps(jumps);
 
 	// Put Bob in a random tree
-	current_tree = U( *MersenneTwister::get_engine() );
+	current_tree = BulkRandom::get_engine()->bounded( n_trees );
 }
 
 
@@ -42,11 +47,8 @@ unsigned JumpingMonkeyInstance::restart()
 	// Get number of trees
 	const unsigned n = forest.size();
 
-	// Create uniform distribution
-	std::uniform_int_distribution<unsigned> U( 0, n-1 );
-
 	// Put Bob in a random tree
-	return current_tree = U( *MersenneTwister::get_engine() );	
+	return current_tree = BulkRandom::get_engine()->bounded( n );
 }
 
 
@@ -68,54 +70,152 @@ unsigned JumpingMonkeyInstance::jump()
 
 
 /**
- * [ResultsStatistics::process Compute statistics from benchmark results.]
- * @param results [The counts vector for each hunter.]
- * @param times   [The time vector for each hunter.]
+ * [ResultsStatistics::clear Reset all statistics.]
  */
-void ResultsStatistics::process( const std::vector<int>& results, const std::vector<double>& times )
+void ResultsStatistics::clear()
 {
-	// Safety check
-	if ( results.size() != times.size() ) return;
+	n_samples = n_success = n_censored = 0;
+	shots.clear(); time.clear(); setup.clear();
+	setup_counters.clear(); shoot_counters.clear();
 
-	// Set number of samples
-	n_samples = results.size();
+	n_instances = 0;
+	instance_shots.clear(); instance_success.clear(); instance_time.clear();
+}
 
-	// Initialize members
-	average = std = success_ratio = 0.0; 
-	max = 0; min = std::numeric_limits<int>::max();
-	time_min = std::numeric_limits<double>::max();
-	time_average = time_max = 0.0;
 
-	// Compute average, success ratio, min and max
-	auto r = results.begin();
-	auto t = times.begin();
-	for ( ; r != results.end(); ++r, ++t ) if ( *r > 0 ) 
-		{
-			// Update average and success ratio 
-			average += *r; success_ratio += 1.0;
 
-			// Update average time
-			time_average += *t;
+/**
+ * [ResultsStatistics::add_hunt Account for the result of one hunt.]
+ * @param count   [Output of Benchmark::run_hunt.]
+ * @param seconds [Duration of the hunt.]
+ */
+void ResultsStatistics::add_hunt( const int& count, const double& seconds )
+{
+	++n_samples;
 
-			// Update min/max
-			if ( *r < min ) min = *r;
-			if ( *r > max ) max = *r;
+	if ( count == BENCHMARK_CENSORED ) ++n_censored;
+	else if ( count > 0 )
+	{
+		++n_success;
+		shots.add( count );
+		time.add( seconds );
+	}
+}
 
-			// Update min and max times
-			if ( *t < time_min ) time_min = *t;
-			if ( *t > time_max ) time_max = *t;
-		}
 
-	average       /= success_ratio; 
-	time_average  /= success_ratio; 
-	success_ratio /= n_samples;
 
-	// Evaluate std
-	if ( n_samples > 1 ){ 
-	for ( auto r = results.begin(); r != results.end(); ++r )
+/**
+ * [ResultsStatistics::add_setup Account for the duration of one set_forest.]
+ * @param seconds [Duration of set_forest.]
+ */
+void ResultsStatistics::add_setup( const double& seconds )
+{
+	setup.add( seconds );
+}
+
+
+
+/**
+ * [ResultsStatistics::merge Merge the statistics of other hunts.]
+ * @param other [The other statistics.]
+ */
+void ResultsStatistics::merge( const ResultsStatistics& other )
+{
+	n_samples  += other.n_samples;
+	n_success  += other.n_success;
+	n_censored += other.n_censored;
+
+	shots.merge( other.shots );
+	time.merge( other.time );
+	setup.merge( other.setup );
+
+	setup_counters.merge( other.setup_counters );
+	shoot_counters.merge( other.shoot_counters );
+
+	n_instances += other.n_instances;
+	instance_shots.merge( other.instance_shots );
+	instance_success.merge( other.instance_success );
+	instance_time.merge( other.instance_time );
+}
+
+
+
+/**
+ * [ResultsStatistics::add_instance Merge the statistics of a single instance, and account for its means.]
+ * @param instance [Statistics of the hunts of one instance.]
+ */
+void ResultsStatistics::add_instance( const ResultsStatistics& instance )
+{
+	merge( instance );
+
+	++n_instances;
+	instance_success.add( instance.success_ratio() );
+	if ( instance.n_success )
 	{
-		const double a = *r - average; std += a*a;
-	}	std = sqrt( std / (n_samples-1) ); }
+		instance_shots.add( instance.shots.mean() );
+		instance_time.add( instance.time.mean() );
+	}
+}
+
+
+
+/**
+ * [ResultsStatistics::precision_ratio Compare the confidence intervals with the targets.]
+ * Shots and times are only checked once at least two instances had successful hunts.
+ * @param  P [Target precision.]
+ * @return   [Largest ratio between a half-width and its target, infinity with less than 2 instances.]
+ */
+double ResultsStatistics::precision_ratio( const SweepPrecision& P ) const
+{
+	if ( n_instances < 2 ) return std::numeric_limits<double>::infinity();
+
+	double ratio = 0.0;
+
+	if ( P.success > 0.0 ) 
+		ratio = std::max( ratio, half_width(instance_success) / P.success );
+	if ( P.shots > 0.0 && instance_shots.size() > 1 ) 
+		ratio = std::max( ratio, half_width(instance_shots) / (P.shots * instance_shots.mean()) );
+	if ( P.time > 0.0 && instance_time.size() > 1 && instance_time.mean() > 0.0 ) 
+		ratio = std::max( ratio, half_width(instance_time) / (P.time * instance_time.mean()) );
+
+	return ratio;
+}
+
+
+
+/**
+ * [ResultsStatistics::save Write all statistics.]
+ * @param f [Output file.]
+ */
+void ResultsStatistics::save( FILE *f ) const
+{
+	fprintf( f, "%llu %llu %llu %llu", (unsigned long long) n_samples, (unsigned long long) n_success, 
+		(unsigned long long) n_censored, (unsigned long long) n_instances );
+
+	const StreamingStatistics *S[] = { &shots, &time, &setup, &instance_shots, &instance_success, &instance_time };
+	for ( unsigned k = 0; k < 6; ++k ) { fprintf( f, " " ); S[k]->save(f); }
+
+	fprintf( f, " " ); setup_counters.save(f);
+	fprintf( f, " " ); shoot_counters.save(f);
+}
+
+
+
+/**
+ * [ResultsStatistics::load Read statistics written by save.]
+ * @param  f [Input file.]
+ * @return   [False if the input is invalid.]
+ */
+bool ResultsStatistics::load( FILE *f )
+{
+	unsigned long long a, b, c, d;
+	if ( fscanf( f, "%llu %llu %llu %llu", &a, &b, &c, &d ) != 4 ) return false;
+	n_samples = a; n_success = b; n_censored = c; n_instances = d;
+
+	StreamingStatistics *S[] = { &shots, &time, &setup, &instance_shots, &instance_success, &instance_time };
+	for ( unsigned k = 0; k < 6; ++k ) if ( !S[k]->load(f) ) return false;
+
+	return setup_counters.load(f) && shoot_counters.load(f);
 }
 
 
@@ -126,11 +226,82 @@ void ResultsStatistics::process( const std::vector<int>& results, const std::vec
  */
 void ResultsStatistics::print( const char* name ) const
 {
-	printf("%s's performances summary (%u samples):\n", name, n_samples);
-	printf("\t- Min=%d, Max=%d\n", min, max);
-	printf("\t- Avg=%.5f, Std=%.5f\n", average, std);
-	printf("\t- Time (ms): avg=%.5f, min=%.5f, max=%.5f\n", time_average*1000, time_min*1000, time_max*1000);
-	printf("\t- Success ratio=%.2f%%\n", 100*success_ratio);
+	printf("%s's performances summary (%lu samples):\n", name, (unsigned long) n_samples);
+	if ( n_success )
+	{
+	printf("\t- Min=%.0f, Max=%.0f\n", shots.min(), shots.max());
+	printf("\t- Avg=%.5f, Std=%.5f\n", shots.mean(), shots.std());
+	printf("\t- P50=%.0f, P90=%.0f, P99=%.0f\n", shots.quantile(0.5,true), shots.quantile(0.9,true), 
+		shots.quantile(0.99,true));
+	}
+	if ( setup.size() )
+	printf("\t- Setup time (ms): avg=%.5f, min=%.5f, max=%.5f\n", setup.mean()*1000, setup.min()*1000, setup.max()*1000);
+	if ( n_success )
+	{
+	printf("\t- Hunt time (ms): avg=%.5f, min=%.5f, max=%.5f\n", time.mean()*1000, time.min()*1000, time.max()*1000);
+	printf("\t- Hunt time (ms): P50=%.5f, P90=%.5f, P99=%.5f\n", 
+		time.quantile(0.5)*1000, time.quantile(0.9)*1000, time.quantile(0.99)*1000);
+	printf("\t- Shot time (us): avg=%.5f\n", shot_time()*1e6);
+	}
+	printf("\t- Success ratio=%.2f%%\n", 100*success_ratio());
+	if ( n_instances > 1 )
+	printf("\t- 95%% CI over %lu instances: shots +-%.5f, success +-%.2f%%, hunt time (ms) +-%.5f\n", 
+		(unsigned long) n_instances, half_width(instance_shots), 100*half_width(instance_success), 
+		1000*half_width(instance_time));
+	if ( n_censored )
+	printf("\t- Censored ratio=%.2f%%\n", 100*censored_ratio());
+
+	setup_counters.print( "Set forest", "call" );
+	shoot_counters.print( "Shoot", "shot" );
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [PlanComparison::clear Reset all counts.]
+ */
+void PlanComparison::clear()
+{
+	n_instances = n_shots = n_divergent = 0;
+	first_min = std::numeric_limits<unsigned>::max();
+	first_average = 0.0;
+}
+
+
+
+/**
+ * [PlanComparison::process Account for the comparison of one instance.]
+ * @param first_divergence [Index of the first different shot, or -1 if the plans are identical.]
+ */
+void PlanComparison::process( const int& first_divergence )
+{
+	++n_instances;
+	if ( first_divergence < 0 ) return;
+
+	// Update average and min index of divergence
+	first_average = (n_divergent*first_average + first_divergence) / (n_divergent+1);
+	if ( (unsigned) first_divergence < first_min ) first_min = first_divergence;
+
+	++n_divergent;
+}
+
+
+
+/**
+ * [PlanComparison::print Display contents on stdout.]
+ * @param name [Name of the compared hunter.]
+ */
+void PlanComparison::print( const char* name ) const
+{
+	printf("%s's plans comparison (%u instances, %u shots):\n", name, n_instances, n_shots);
+	printf("\t- Divergent plans=%u (%.2f%%)\n", n_divergent, n_instances ? 100.0*n_divergent/n_instances : 0.0);
+	if ( n_divergent )
+	printf("\t- First divergent shot: min=%u, avg=%.5f\n", first_min, first_average);
 }
 
 
@@ -145,18 +316,27 @@ void ResultsStatistics::print( const char* name ) const
  */
 void Benchmark::clear()
 {
-	// Disable pointers
-	angelo = jonathan = nullptr;
+	// Unregister hunters
+	hunters.clear();
 
 	// Reset scalars
-	n_trees = n_instances = n_trials = 0;
+	n_trees = n_instances = n_trials = max_shots = n_threads = 0;
+	max_seconds = 0.0;
+	generator   = CUR_GENERATOR;
+	jumps       = UNIFORM_JUMPS;
+	counters    = stratified = false;
 
-	// Clear vectors
-	counts_angelo.clear();
-	counts_jonathan.clear();
+	// Single process
+	shard_index = 0; shard_count = 1;
+	shard_file.clear();
 
-	time_angelo.clear();
-	time_jonathan.clear();
+	// No target precision
+	precision.shots = precision.success = precision.time = 0.0;
+	precision.max_instances = 0;
+
+	// New random seed
+	seed = (uint64_t) BulkRandom::random_seed() << 32 | BulkRandom::random_seed();
+	seeded = false;
 
 	// Clear instance
 	instance.clear();
@@ -175,13 +355,6 @@ void Benchmark::setup( const unsigned& trees, const unsigned& instances, const u
 	// Set members
 	n_trees = trees; n_instances = instances; n_trials = trials;
 
-	// Allocate counts and times
-	counts_angelo.reserve( n_instances*n_trials );
-	counts_jonathan.reserve( n_instances*n_trials );
-
-	time_angelo.reserve( n_instances*n_trials );
-	time_jonathan.reserve( n_instances*n_trials );
-
 #ifdef BENCHMARK_VERBOSE
 
 	printf("---------- CONFIGURATION ----------\n");
@@ -195,54 +368,608 @@ void Benchmark::setup( const unsigned& trees, const unsigned& instances, const u
 
 
 /**
- * [Benchmark::set_hunters Register both hunters.]
- * @param  A [Angelo.]
- * @param  J [Jonathan.]
+ * [Benchmark::add_hunter Register a new hunter.]
+ * @param  name  [Name of the hunter, used to print the results.]
+ * @param  chuck [The hunter.]
+ * @return       [Index of the hunter in the results.]
  */
-void Benchmark::set_hunters( ChuckInterface *A, ChuckInterface *J )
+unsigned Benchmark::add_hunter( const char* name, ChuckInterface *chuck )
 {
-	angelo   = A; 
-	jonathan = J;
+	Hunter h; 
+	h.name   = name; 
+	h.chuck  = chuck;
+
+	hunters.push_back(h);
+	return hunters.size()-1;
 }
 
 
 
+/**
+ * [Benchmark::set_budget Bound the duration of each hunt.]
+ * @param shots   [Max number of shots per hunter and trial (0 for unlimited).]
+ * @param seconds [Max wall-clock time per hunter and trial (0 for unlimited).]
+ */
+void Benchmark::set_budget( const unsigned& shots, const double& seconds )
+{
+	max_shots   = shots;
+	max_seconds = seconds;
+}
+
+
 
 /**
  * [Benchmark::run Run the benchmark after setup and registration.]
- * @param  A [Angelo's results.]
- * @param  J [Jonathan's results.]
- * @return   [Benchmark success.]
+ * @param  results [Results of each hunter, in the order of registration.]
+ * @return         [Benchmark success.]
  */
-bool Benchmark::run( result_type& A, result_type& J )
+bool Benchmark::run( std::vector<result_type>& results )
 {
 	// Safety check
 	if ( !*this ) return false;
 
-	// Clear counts and times
-	counts_angelo.clear();
-	counts_jonathan.clear();
+	// Sweep with a single size
+	const SweepSize size = { n_trees, n_instances, n_trials };
+	std::vector< std::vector<result_type> > sweep_results;
+
+	if ( !run_sweep( std::vector<SweepSize>(1,size), sweep_results ) ) return false;
+
+	results.swap( sweep_results[0] );
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::run_sweep Run all instances of several sizes on a pool of threads.]
+ * @param  sizes   [Configuration of each size.]
+ * @param  results [Results of each size, for each hunter in the order of registration.]
+ * @return         [Benchmark success.]
+ */
+bool Benchmark::run_sweep( const std::vector<SweepSize>& sizes, std::vector< std::vector<result_type> >& results )
+{
+	// Safety check
+	if ( hunters.empty() ) return false;
+
+	// Merged results of each size
+	results.assign( sizes.size(), std::vector<result_type>( hunters.size() ) );
+	generation.assign( sizes.size(), PerfCounts() );
+	walk.assign( sizes.size(), PerfCounts() );
+	events.assign( sizes.size(), CounterValues() );
+
+	// Instances merged, and to be done, for each size
+	std::vector<unsigned> merged( sizes.size(), 0 ), last( sizes.size() );
+	for ( unsigned s = 0; s < sizes.size(); ++s ) last[s] = sizes[s].instances;
+
+	// Resume from a checkpoint
+	const bool sharded = shard_count > 1;
+	if ( !sharded && !checkpoint_file.empty() && load_checkpoint( sizes, results, merged, last ) )
+		printf("Resuming sweep from %s.\n", checkpoint_file.c_str());
+
+	// Partial results of a shard are written aside, and renamed at the end
+	FILE *partial = nullptr; const std::string partial_tmp = shard_file + ".tmp";
+	if ( sharded )
+	{
+		if ( !(partial = fopen( partial_tmp.c_str(), "w" )) ) return false;
+		save_header( partial, "shard", sizes );
+		fprintf( partial, "%u %u\n", shard_index, shard_count );
+	}
+
+	Stopwatch since_checkpoint; since_checkpoint.start();
+
+	// Each worker owns clones of the hunters
+	WorkStealingPool pool( n_threads );
+	std::vector<Worker> workers( pool.size() );
+
+	for ( auto w = workers.begin(); w != workers.end(); ++w )
+		for ( auto h = hunters.cbegin(); h != hunters.cend(); ++h )
+			w->hunters.push_back( std::unique_ptr<ChuckInterface>( h->chuck->clone() ) );
+
+	unsigned max_trees = 0;
+	for ( auto s = sizes.cbegin(); s != sizes.cend(); ++s ) max_trees = std::max( max_trees, s->trees );
+
+	// Run rounds of instances until every size is done
+	for (;;)
+	{
+		// Flatten (size, instance) pairs; shards take every shard_count-th pair
+		std::vector<unsigned> task_size, task_index;
+		for ( unsigned s = 0, position = 0; s < sizes.size(); ++s )
+		for ( unsigned i = merged[s]; i < last[s]; ++i, ++position ) 
+			if ( !sharded || position % shard_count == shard_index )
+		{
+			task_size.push_back(s);
+			task_index.push_back(i);
+		}
+
+		if ( task_size.empty() ) break;
+
+		// Results of the tasks that are done but not merged yet
+		std::vector<InstanceResults> task_results( task_size.size() );
+		std::vector<bool> done( task_size.size(), false );
+		unsigned cursor = 0;
+
+		// Counters are opened, and storage is reserved, by the threads of the round that use them
+		for ( auto w = workers.begin(); w != workers.end(); ++w ) w->perf_opened = w->reserved = false;
+
+		// Run all tasks
+		bool success = true; std::mutex lock;
+		pool.run( task_size.size(), [&]( const unsigned& task, const unsigned& worker )
+		{
+			InstanceResults R; Worker& W = workers[worker];
+
+			if ( counters && !W.perf_opened ) { W.perf.open(); W.perf_opened = true; }
+			if ( !W.reserved ) { reserve( W, max_trees ); W.reserved = true; }
+
+			seed_instance( sizes[ task_size[task] ].trees, task_index[task] );
+			const bool ok = run_instance( W, sizes[ task_size[task] ], R );
+
+			std::lock_guard<std::mutex> guard(lock);
+			success = success && ok;
+
+			// Merge all consecutive tasks that are done, in order
+			std::swap( task_results[task], R ); done[task] = true;
+			for ( ; cursor < done.size() && done[cursor]; ++cursor )
+			{
+				InstanceResults& M = task_results[cursor];
+				const unsigned s = task_size[cursor];
+
+				for ( unsigned k = 0; k < M.hunters.size(); ++k ) 
+					results[s][k].add_instance( M.hunters[k] );
+				generation[s].merge( M.generation );
+				walk[s].merge( M.walk );
+				events[s].merge( M.counters );
+				++merged[s];
+
+				if ( partial ) save_instance( partial, s, task_index[cursor], M );
+
+				std::vector<result_type>().swap( M.hunters );
+			}
+
+			// Periodic checkpoint
+			if ( !sharded && !checkpoint_file.empty() && since_checkpoint.stop() > checkpoint_period )
+			{
+				save_checkpoint( sizes, results, merged, last );
+				since_checkpoint.start();
+			}
+		});
+
+		if ( !success ) { if ( partial ) fclose( partial ); return false; }
+
+		// Shards run a single round, the others are left to the merge
+		if ( sharded ) return commit_file( partial, partial_tmp, shard_file );
+
+		// Sizes that are not precise enough get more instances
+		for ( unsigned s = 0; s < sizes.size(); ++s )
+			last[s] = next_instances( results[s], merged[s] );
+
+		if ( !checkpoint_file.empty() && !save_checkpoint( sizes, results, merged, last ) )
+			printf("Could not write the checkpoint %s.\n", checkpoint_file.c_str());
+	}
+
+	// The sweep is complete, a new run starts over
+	if ( !checkpoint_file.empty() ) std::remove( checkpoint_file.c_str() );
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::save_header Write the configuration of a sweep.]
+ * Header: magic and version, seed, generator, jumps, number of hunters and sizes, budgets
+ * of shots and seconds, stratified starts, target precision (shots, success, time, cap), 
+ * then the names of the hunters and the (trees, instances, trials) of each size. Reals are
+ * written with all their digits, so that they are read back exactly.
+ * @param f     [Output file.]
+ * @param magic [Kind of file.]
+ * @param sizes [Configuration of each size.]
+ */
+void Benchmark::save_header( FILE *f, const char *magic, const std::vector<SweepSize>& sizes ) const
+{
+	fprintf( f, "%s 5\n%llu %d %d %u %u %u %.17g %d %.17g %.17g %.17g %u\n", magic, (unsigned long long) seed, 
+		(int) generator, (int) jumps, (unsigned) hunters.size(), (unsigned) sizes.size(), max_shots, max_seconds, 
+		(int) stratified, precision.shots, precision.success, precision.time, precision.max_instances );
+
+	for ( auto h = hunters.cbegin(); h != hunters.cend(); ++h ) fprintf( f, "%s\n", h->name );
+	for ( auto s = sizes.cbegin(); s != sizes.cend(); ++s ) fprintf( f, "%u %u %u\n", s->trees, s->instances, s->trials );
+}
+
+
+
+/**
+ * [Benchmark::load_header Read the configuration of a sweep, and check that it matches.]
+ * Generator, jumps, budgets, stratified starts, target precision, hunters and sizes must 
+ * match; the seed is read, and must match too if one was set.
+ * @param  f     [Input file.]
+ * @param  magic [Kind of file.]
+ * @param  sizes [Configuration of each size.]
+ * @param  s0    [Output seed.]
+ * @return       [False if the header is invalid or doesn't match.]
+ */
+bool Benchmark::load_header( FILE *f, const char *magic, const std::vector<SweepSize>& sizes, uint64_t& s0 ) const
+{
+	char kind[32], name[256]; unsigned long long s; int g, j, st; unsigned version, nh, ns, shots, cap;
+	double seconds; SweepPrecision P;
+
+	bool ok = fscanf( f, "%31s %u %llu %d %d %u %u %u %lf %d %lf %lf %lf %u", kind, &version, &s, &g, &j, &nh, &ns, 
+		&shots, &seconds, &st, &P.shots, &P.success, &P.time, &cap ) == 14 && 
+		!strcmp( kind, magic ) && version == 5 && g == (int) generator && j == (int) jumps && 
+		nh == hunters.size() && ns == sizes.size() && shots == max_shots && seconds == max_seconds && 
+		st == (int) stratified && P.shots == precision.shots && P.success == precision.success && 
+		P.time == precision.time && cap == precision.max_instances && (!seeded || s == seed);
+
+	for ( unsigned k = 0; ok && k < nh; ++k ) 
+		ok = fscanf( f, "%255s", name ) == 1 && !strcmp( name, hunters[k].name );
+
+	for ( unsigned k = 0; ok && k < ns; ++k )
+	{
+		unsigned trees, instances, trials;
+		ok = fscanf( f, "%u %u %u", &trees, &instances, &trials ) == 3 && trees == sizes[k].trees && 
+			instances == sizes[k].instances && trials == sizes[k].trials;
+	}
+
+	s0 = s;
+	return ok;
+}
+
+
+
+/**
+ * [Benchmark::commit_file Flush, sync and close a file written aside, then rename it.]
+ * A process killed at any time leaves either the previous or the new file.
+ * @param  f    [File opened on tmp.]
+ * @param  tmp  [Temporary name.]
+ * @param  name [Final name.]
+ * @return      [False if anything failed.]
+ */
+bool Benchmark::commit_file( FILE *f, const std::string& tmp, const std::string& name )
+{
+	bool ok = fflush(f) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+	ok = ok && fsync( fileno(f) ) == 0;
+#endif
+	ok = (fclose(f) == 0) && ok;
+
+	return ok && rename( tmp.c_str(), name.c_str() ) == 0;
+}
 
-	time_angelo.clear();
-	time_jonathan.clear();
+
+
+/**
+ * [Benchmark::save_checkpoint Write the state of a sweep atomically.]
+ * @param  sizes   [Configuration of each size.]
+ * @param  results [Merged results of each size.]
+ * @param  merged  [Number of instances merged for each size.]
+ * @param  last    [Number of instances to run for each size.]
+ * @return         [False if the file could not be written.]
+ */
+bool Benchmark::save_checkpoint( const std::vector<SweepSize>& sizes, const std::vector< std::vector<result_type> >& results, 
+	const std::vector<unsigned>& merged, const std::vector<unsigned>& last ) const
+{
+	const std::string tmp = checkpoint_file + ".tmp";
+
+	FILE *f = fopen( tmp.c_str(), "w" );
+	if ( !f ) return false;
+
+	save_header( f, "checkpoint", sizes );
+
+	// State of each size
+	for ( unsigned s = 0; s < sizes.size(); ++s )
+	{
+		fprintf( f, "%u %u\n", merged[s], last[s] );
+		generation[s].save(f); fprintf( f, "\n" );
+		walk[s].save(f); fprintf( f, "\n" );
+		events[s].save(f); fprintf( f, "\n" );
+
+		for ( auto r = results[s].cbegin(); r != results[s].cend(); ++r ) { r->save(f); fprintf( f, "\n" ); }
+	}
+
+	return commit_file( f, tmp, checkpoint_file );
+}
+
+
+
+/**
+ * [Benchmark::load_checkpoint Restore the state of a sweep with the same configuration.]
+ * The seed is taken from the checkpoint, unless one was set (it must then match). A complete 
+ * sweep is not resumed, since it would return the previous results without running anything.
+ * @param  sizes   [Configuration of each size.]
+ * @param  results [Merged results of each size.]
+ * @param  merged  [Number of instances merged for each size.]
+ * @param  last    [Number of instances to run for each size.]
+ * @return         [False if there is no valid checkpoint for this sweep.]
+ */
+bool Benchmark::load_checkpoint( const std::vector<SweepSize>& sizes, std::vector< std::vector<result_type> >& results, 
+	std::vector<unsigned>& merged, std::vector<unsigned>& last )
+{
+	FILE *f = fopen( checkpoint_file.c_str(), "r" );
+	if ( !f ) return false;
+
+	const unsigned ns = sizes.size(), nh = hunters.size();
+	uint64_t s0; bool ok = load_header( f, "checkpoint", sizes, s0 );
+
+	// Read into temporaries, so that nothing changes unless the whole file is valid
+	std::vector< std::vector<result_type> > R( ns, std::vector<result_type>( nh ) );
+	std::vector<PerfCounts> G( ns ), W( ns );
+	std::vector<CounterValues> E( ns );
+	std::vector<unsigned> M( ns ), L( ns );
+
+	for ( unsigned s = 0; ok && s < ns; ++s )
+	{
+		ok = fscanf( f, "%u %u", &M[s], &L[s] ) == 2 && M[s] <= L[s] && G[s].load(f) && W[s].load(f) && 
+			E[s].load(f);
+		for ( unsigned k = 0; ok && k < nh; ++k ) ok = R[s][k].load(f);
+	}
+
+	fclose(f);
+	if ( !ok ) 
+	{
+		printf("Checkpoint %s is invalid or belongs to another sweep, starting over.\n", checkpoint_file.c_str());
+		return false;
+	}
+
+	if ( M == L ) 
+	{
+		printf("Checkpoint %s is of a complete sweep, starting over.\n", checkpoint_file.c_str());
+		return false;
+	}
+
+	seed = s0;
+	results.swap(R); generation.swap(G); walk.swap(W); events.swap(E);
+	merged.swap(M); last.swap(L);
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::save_instance Append the results of one instance to a partial file.]
+ * @param f [Output file.]
+ * @param s [Index of the size.]
+ * @param i [Index of the instance.]
+ * @param R [Results of the instance.]
+ */
+void Benchmark::save_instance( FILE *f, const unsigned& s, const unsigned& i, const InstanceResults& R ) const
+{
+	fprintf( f, "instance %u %u\n", s, i );
+	R.generation.save(f); fprintf( f, "\n" );
+	R.walk.save(f); fprintf( f, "\n" );
+	R.counters.save(f); fprintf( f, "\n" );
+
+	for ( auto r = R.hunters.cbegin(); r != R.hunters.cend(); ++r ) { r->save(f); fprintf( f, "\n" ); }
+}
+
+
+
+/**
+ * [Benchmark::merge_shards Combine the partial files of all shards of a sweep.]
+ * Instances are merged in the same order as in a single run (size, then instance), so
+ * the statistics of hunts are exactly the same as if the sweep had run in one process.
+ * Every instance must be found exactly once; the seed is taken from the files.
+ * @param  files   [Partial files of the shards.]
+ * @param  sizes   [Configuration of each size.]
+ * @param  results [Results of each size, for each hunter in the order of registration.]
+ * @return         [False if a file is invalid or doesn't match, or if instances are missing.]
+ */
+bool Benchmark::merge_shards( const std::vector<std::string>& files, const std::vector<SweepSize>& sizes, 
+	std::vector< std::vector<result_type> >& results )
+{
+	const unsigned ns = sizes.size(), nh = hunters.size();
+	if ( !nh || files.empty() ) return false;
+
+	// Results of each instance, by size
+	std::vector< std::vector<InstanceResults> > instances( ns );
+	std::vector< std::vector<bool> > found( ns );
+	for ( unsigned s = 0; s < ns; ++s )
+	{
+		instances[s].resize( sizes[s].instances );
+		found[s].assign( sizes[s].instances, false );
+	}
+
+	uint64_t s0 = 0;
+	for ( unsigned k = 0; k < files.size(); ++k )
+	{
+		FILE *f = fopen( files[k].c_str(), "r" );
+		if ( !f ) { printf("Could not read %s.\n", files[k].c_str()); return false; }
+
+		uint64_t sk; unsigned index, count, s, i;
+		bool ok = load_header( f, "shard", sizes, sk ) && (k == 0 || sk == s0) && 
+			fscanf( f, "%u %u", &index, &count ) == 2;
+		s0 = sk;
+
+		while ( ok && fscanf( f, " instance %u %u", &s, &i ) == 2 )
+		{
+			ok = s < ns && i < sizes[s].instances && !found[s][i];
+			if ( !ok ) break;
+
+			InstanceResults& R = instances[s][i];
+			R.hunters.resize( nh );
+			ok = R.generation.load(f) && R.walk.load(f) && R.counters.load(f);
+			for ( unsigned h = 0; ok && h < nh; ++h ) ok = R.hunters[h].load(f);
+
+			found[s][i] = true;
+		}
+
+		ok = ok && feof(f);
+		fclose(f);
+		if ( !ok ) { printf("Invalid or mismatching shard %s.\n", files[k].c_str()); return false; }
+	}
+
+	// Merge in order
+	results.assign( ns, std::vector<result_type>( nh ) );
+	generation.assign( ns, PerfCounts() );
+	walk.assign( ns, PerfCounts() );
+	events.assign( ns, CounterValues() );
+
+	for ( unsigned s = 0; s < ns; ++s )
+	for ( unsigned i = 0; i < sizes[s].instances; ++i )
+	{
+		if ( !found[s][i] ) { printf("Instance %u of size %u is missing.\n", i, sizes[s].trees); return false; }
+
+		const InstanceResults& R = instances[s][i];
+		for ( unsigned h = 0; h < nh; ++h ) results[s][h].add_instance( R.hunters[h] );
+		generation[s].merge( R.generation );
+		walk[s].merge( R.walk );
+		events[s].merge( R.counters );
+	}
+
+	seed = s0;
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::next_instances Number of instances needed for a size to reach the target precision.]
+ * The half-widths of the intervals decrease like 1/sqrt(instances); the number of instances
+ * is extrapolated from the current one, and grows by a factor 4 at most in each round.
+ * The intervals need two instances, so a size with less instances is completed to two.
+ * @param  R    [Current results of the size.]
+ * @param  done [Number of instances done.]
+ * @return      [Total number of instances, done if the size is complete.]
+ */
+unsigned Benchmark::next_instances( const std::vector<result_type>& R, const unsigned& done ) const
+{
+	if ( !precision.enabled() ) return done;
+
+	unsigned next = 2;
+	if ( done >= 2 )
+	{
+		double ratio = 0.0;
+		for ( auto r = R.cbegin(); r != R.cend(); ++r ) ratio = std::max( ratio, r->precision_ratio(precision) );
+
+		if ( ratio <= 1.0 ) return done;
+
+		const double needed = std::ceil( 1.1 * done * ratio * ratio );
+		next = needed > 4.0*done ? 4*done : std::max( (unsigned) needed, done+1 );
+	}
+
+	if ( precision.max_instances && next > precision.max_instances ) next = std::max( done, precision.max_instances );
+	return next;
+}
+
+
+
+/**
+ * [Benchmark::verify Exact worst-case verification of the plans of all hunters.]
+ * This doesn't simulate Bob at all; see PlanVerifier for details.
+ * @param  max_shots [Max length of the plans.]
+ * @param  V         [Verification results of each hunter, in the order of registration.]
+ * @return           [Verification success.]
+ */
+bool Benchmark::verify( const unsigned& max_shots, std::vector<VerificationStatistics>& V )
+{
+	// Safety check
+	if ( !*this ) return false;
+
+	V.resize( hunters.size() );
+	for ( auto v = V.begin(); v != V.end(); ++v ) v->clear();
+
+	VerificationReport report;
 
 	// Iterate on each instance
 	for ( unsigned i = 0; i < n_instances; ++i )
 	{
-		// Create new instance
-		instance.setup(n_trees);
+		// Create new instance (the same as in run)
+		seed_instance( n_trees, i );
+		instance.setup(n_trees,generator,jumps);
+		verifier.set_forest( instance.get_forest() );
 
-		// Set forests
-		if ( !(angelo->set_forest( instance.get_forest() )) || 
-			!(jonathan->set_forest( instance.get_forest() )) ) return false;
+		// Record and verify each plan
+		for ( unsigned k = 0; k < hunters.size(); ++k )
+		{
+			if ( !hunters[k].chuck->set_forest( instance.get_forest() ) ) return false;
 
-		// Run n_trials times
-		run_instance();
+			record_plan( hunters[k].chuck, max_shots, plan );
+			verifier.verify( plan, report );
+			V[k].process( report );
+		}
 	}
 
-	// Compute results
-	A.process( counts_angelo, time_angelo );
-	J.process( counts_jonathan, time_jonathan );
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::evaluate Exact capture-time distribution of the plans of all hunters.]
+ * This replaces the simulation of Bob by the propagation of his distribution, see 
+ * PlanEvaluator for details.
+ * @param  max_shots [Max length of the plans.]
+ * @param  E         [Evaluation results of each hunter, in the order of registration.]
+ * @return           [Evaluation success.]
+ */
+bool Benchmark::evaluate( const unsigned& max_shots, std::vector<EvaluationStatistics>& E )
+{
+	// Safety check
+	if ( !*this ) return false;
+
+	E.resize( hunters.size() );
+	for ( auto e = E.begin(); e != E.end(); ++e ) e->clear(max_shots);
+
+	CaptureReport report;
+
+	// Iterate on each instance
+	for ( unsigned i = 0; i < n_instances; ++i )
+	{
+		// Create new instance (the same as in run)
+		seed_instance( n_trees, i );
+		instance.setup(n_trees,generator,jumps);
+		evaluator.set_forest( instance.get_forest() );
+
+		// Record and evaluate each plan
+		for ( unsigned k = 0; k < hunters.size(); ++k )
+		{
+			if ( !hunters[k].chuck->set_forest( instance.get_forest() ) ) return false;
+
+			record_plan( hunters[k].chuck, max_shots, plan );
+			evaluator.evaluate( plan, report );
+			E[k].process( report );
+		}
+	}
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [Benchmark::compare Compare the plans of two hunters on the same forests.]
+ * @param  reference [The reference hunter.]
+ * @param  other     [The hunter to compare.]
+ * @param  n_shots   [Number of shots to compare in each forest.]
+ * @param  C         [Comparison results.]
+ * @return           [Comparison success.]
+ */
+bool Benchmark::compare( ChuckInterface *reference, ChuckInterface *other, 
+	const unsigned& n_shots, PlanComparison& C )
+{
+	// Safety check
+	if ( !reference || !other || !n_trees ) return false;
+
+	C.clear(); C.n_shots = n_shots;
+
+	// Iterate on each instance
+	for ( unsigned i = 0; i < n_instances; ++i )
+	{
+		// Create new instance (the same as in run)
+		seed_instance( n_trees, i );
+		instance.setup(n_trees,generator,jumps);
+
+		// Set forests
+		if ( !(reference->set_forest( instance.get_forest() )) || 
+			!(other->set_forest( instance.get_forest() )) ) return false;
+
+		// Find the first different shot
+		int first_divergence = -1;
+		for ( unsigned s = 0; s < n_shots && first_divergence < 0; ++s )
+			if ( reference->shoot() != other->shoot() ) first_divergence = s;
+
+		C.process( first_divergence );
+	}
 
 	// Report success
 	return true;
@@ -255,69 +982,186 @@ bool Benchmark::run( result_type& A, result_type& J )
 
 
 /**
- * [Benchmark::run_instance Internal method to run tests on one specific forest.]
+ * [Benchmark::seed_instance Reseed the random engine of the calling thread.]
+ * The forest and the trajectories of an instance only depend on the seed of the 
+ * benchmark, the number of trees and the index of the instance.
+ * @param trees [Number of trees.]
+ * @param index [Index of the instance.]
  */
-void Benchmark::run_instance()
+void Benchmark::seed_instance( const unsigned& trees, const unsigned& index ) const
 {
-	// Prepare local variables
-	unsigned monkey;
-	bool killed_a, killed_j;
+	BulkRandom::seed( mix64( seed ^ mix64( (uint64_t) trees << 32 | index ) ) );
+}
 
-	// Iterate on trials
-	for ( unsigned t = 0; t < n_trials; ++t )
+
+
+/**
+ * [Benchmark::reserve Reserve the storage of a worker for the largest forests of a sweep.]
+ * This is called from the thread of the worker, whose scratch space is reserved as well.
+ * Then instances don't allocate, unless the hunts have no budget of shots.
+ * @param worker [State of the calling thread.]
+ * @param trees  [Max number of trees.]
+ */
+void Benchmark::reserve( Worker& worker, const unsigned& trees ) const
+{
+	worker.instance.reserve( trees );
+	for ( auto h = worker.hunters.begin(); h != worker.hunters.end(); ++h ) 
+		(*h)->reserve( trees, max_shots );
+
+	// Bob's trajectory holds his first tree and a position per shot
+	if ( max_shots ) worker.trajectory.reserve( max_shots + 1 );
+	worker.starts.reserve( trees );
+	worker.shots.resize( BENCHMARK_BLOCK );
+}
+
+
+
+/**
+ * [Benchmark::run_instance Internal method to run tests on one new forest.]
+ * @param  worker [State of the calling thread.]
+ * @param  size   [Configuration of the instance.]
+ * @param  R      [Output statistics of each hunter, and events of the shared phases.]
+ * @return        [False if a hunter could not be set.]
+ */
+bool Benchmark::run_instance( Worker& worker, const SweepSize& size, InstanceResults& R ) const
+{
+	const unsigned n_hunters = worker.hunters.size();
+	Stopwatch watch;
+
+	// Count the slow paths of this instance only
+	Counters::clear();
+
+	// Heap allocations of the phases (the results are not counted)
+	AllocationSection alloc;
+	bool allocated = false;
+
+	// Create new instance
+	worker.perf.start(); alloc.start();
+	worker.instance.setup( size.trees, generator, jumps );
+	allocated |= alloc.stop( COUNTER_ALLOC_GENERATION, COUNTER_BYTES_GENERATION );
+	worker.perf.stop( R.generation );
+
+	// Set forests
+	R.hunters.assign( n_hunters, result_type() );
+	for ( unsigned k = 0; k < n_hunters; ++k )
 	{
-		// Put Bob somewhere
-		monkey = instance.restart();
+		result_type& H = R.hunters[k];
 
-		// Notify hunters
-		angelo->restart();
-		jonathan->restart();
+		worker.perf.start(); watch.start(); alloc.start();
+		if ( !worker.hunters[k]->set_forest( worker.instance.get_forest() ) ) return false;
+		allocated |= alloc.stop( COUNTER_ALLOC_SET_FOREST, COUNTER_BYTES_SET_FOREST );
+		H.add_setup( watch.stop() ); worker.perf.stop( H.setup_counters );
+	}
 
-		// Initialize counters, times and flags
-		counts_angelo.push_back(0);
-		counts_jonathan.push_back(0);
+	// Stratified starts: trials go through a random permutation of the trees
+	if ( stratified )
+	{
+		worker.starts.resize( size.trees );
+		for ( unsigned t = 0; t < size.trees; ++t ) worker.starts[t] = t;
 
-		time_angelo.push_back(0.0);
-		time_jonathan.push_back(0.0);
+		// Fisher-Yates, with the same draws on every platform
+		BulkRandom *engine = BulkRandom::get_engine();
+		for ( unsigned t = size.trees; t > 1; --t ) 
+			std::swap( worker.starts[t-1], worker.starts[ engine->bounded(t) ] );
+	}
 
-		killed_a = killed_j = false;
+	// Iterate on trials
+	double time;
+	for ( unsigned t = 0; t < size.trials; ++t )
+	{
+		// Put Bob somewhere
+		alloc.start();
+		worker.trajectory.clear();
+		worker.trajectory.push_back( stratified ? 
+			worker.instance.restart( worker.starts[ t % size.trees ] ) : worker.instance.restart() );
 
-		// Start the competition
-		while ( !killed_a || !killed_j )
+		// Each hunter shoots at the same trajectory
+		for ( unsigned k = 0; k < n_hunters; ++k )
 		{
-			// Let the hunters shoot
-			if ( !killed_a ) run_shooting( angelo, monkey, counts_angelo.back(), time_angelo.back(), killed_a );
-			if ( !killed_j ) run_shooting( jonathan, monkey, counts_jonathan.back(), time_jonathan.back(), killed_j );
+			result_type& H = R.hunters[k];
+			const int count = run_hunt( worker, worker.hunters[k].get(), time, H.shoot_counters, R.walk );
+			allocated |= alloc.stop( COUNTER_ALLOC_HUNT, COUNTER_BYTES_HUNT );
 
-			// Let Bob jump
-			monkey = instance.jump();
+			H.add_hunt( count, time ); alloc.start();
 		}
 	}
+	if ( allocated ) Counters::add( COUNTER_ALLOC_INSTANCES );
+
+	// Software counters of the instance
+	R.counters.clear();
+	Counters::collect( R.counters );
+
+	// Report success
+	return true;
 }
 
 
 
 /**
- * [Benchmark::run_shooting Generic (independent of actual player) method to run a single shooting.]
- * @param chuck  [Pointer to Chuck's interface.]
- * @param bob    [Current position of Bob.]
- * @param count  [Current shot_count for the player.]
- * @param time   [Current timer for the player.]
- * @param killed [Will be set to true if Bob is killed.]
+ * [Benchmark::run_hunt Generic (independent of actual player) method to run a single hunt.]
+ * Bob's trajectory is extended as needed (outside of the timed sections), and shared by 
+ * all hunters of the trial. Chuck shoots batches of BENCHMARK_FIRST_BATCH shots, doubling
+ * up to BENCHMARK_BLOCK, so that short hunts don't waste many shots after the kill.
+ * The time budget starts with the hunt, so it doesn't include the hunters before in the 
+ * trial, but it does include the extension of the trajectory.
+ * @param  worker [State of the calling thread.]
+ * @param  chuck  [Pointer to Chuck's interface.]
+ * @param  time   [Output hunt time.]
+ * @param  shoot  [Hardware events while shooting.]
+ * @param  walk   [Hardware events while extending the trajectory.]
+ * @return        [Number of shots to kill Bob, -1 if Chuck gave up, or BENCHMARK_CENSORED.]
  */
-void Benchmark::run_shooting( ChuckInterface *chuck, const unsigned& bob, int& count, double& time, bool& killed )
+int Benchmark::run_hunt( Worker& worker, ChuckInterface *chuck, double& time, PerfCounts& shoot, PerfCounts& walk ) const
 {
-	// Start clock
-	const clock_t t = clock();
+	std::vector<unsigned>& trajectory = worker.trajectory;
+	worker.shots.resize( BENCHMARK_BLOCK );
+	Stopwatch watch, budget;
+
+	budget.start();
+	chuck->restart();
+	time = 0.0;
+
+	for ( unsigned count = 0, batch = BENCHMARK_FIRST_BATCH; ; batch = std::min( 2*batch, (unsigned) BENCHMARK_BLOCK ) )
+	{
+		// Don't shoot beyond the budget
+		if ( max_shots ) batch = std::min( batch, max_shots - count );
+
+		// Extend Bob's trajectory
+		if ( trajectory.size() < count + batch )
+		{
+			const unsigned jumps = count + batch - trajectory.size();
 
-	// Shoot
-	int shot = chuck->shoot(); ++count;
+			worker.perf.start();
+			while ( trajectory.size() < count + batch ) 
+				trajectory.push_back( worker.instance.jump() );
+			worker.perf.stop( walk, jumps );
+		}
+
+		// Shoot a batch
+		worker.perf.start(); watch.start();
+		const unsigned fired = chuck->shoot_batch( &worker.shots[0], batch );
+		const double t = watch.stop(); worker.perf.stop( shoot, fired );
 
-	if ( shot < 0 ) { count = -1; killed = true; }
-	else if ( shot == (int) bob ) killed = true; 
+		// Find the first shot that hit Bob
+		const unsigned hit = first_equal( &worker.shots[0], 
+			reinterpret_cast<const int*>( &trajectory[count] ), fired );
 
-	// Add to timer
-	time += ((double) clock() - t) / CLOCKS_PER_SEC;
+		// Bob is dead; shots after the kill are not accounted for
+		if ( hit < fired ) 
+		{
+			time += t * (hit+1) / fired;
+			return count + hit + 1;
+		}
+
+		time += t; count += fired;
+
+		// Chuck gave up
+		if ( fired < batch ) return -1;
+
+		// Check budgets
+		if ( (max_shots && count >= max_shots) || (max_seconds > 0.0 && budget.stop() > max_seconds) ) 
+			return BENCHMARK_CENSORED;
+	}
 }
 
 
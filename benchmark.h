@@ -11,13 +11,29 @@
 //=============================================
 
 #include <ctime>
+#include <cmath>
+#include <chrono>
 #include <cstdio>
 #include <vector>
 #include <limits>
+#include <memory>
+#include <string>
 #include "random_engine.h"
 #include "chuck.h"
+#include "analysis.h"
+#include "thread_pool.h"
+#include "timer.h"
+#include "statistics.h"
+#include "perf_counters.h"
+#include "counters.h"
+#include "allocations.h"
 
 #define BENCHMARK_VERBOSE
+#define BENCHMARK_CENSORED 0
+#define BENCHMARK_BLOCK 64
+#define BENCHMARK_FIRST_BATCH 4
+#define BENCHMARK_Z95 1.959964
+#define BENCHMARK_CHECKPOINT_PERIOD 60.0
 
 
 
@@ -36,14 +52,19 @@ public:
 	// Clear member data
 	inline void clear() { forest.clear(); }
 
+	// Reserve storage for forests with up to n_trees trees (see Forest::reserve)
+	inline void reserve( const unsigned& n_trees ) { forest.reserve(n_trees); }
+
 	// Is the instance ready?
 	inline operator bool() const { return forest; }
 
 	// Generate a new forest and put Bob somewhere
-	void setup( const unsigned& n_trees );
+	void setup( const unsigned& n_trees, const ForestGenerator& generator = CUR_GENERATOR, 
+		const JumpModel& jumps = UNIFORM_JUMPS );
 
-	// Put Bob in a random tree
+	// Put Bob in a random tree, or in a given one
 	unsigned restart();
+	inline unsigned restart( const unsigned& tree ) { return current_tree = tree; }
 
 	// Make Bob jump
 	unsigned jump();
@@ -66,27 +87,143 @@ private:
 
 
 /**
- * Compute results statistics from benchmark.
+ * Target precision of a sweep: half-widths of the 95% confidence intervals, relative to 
+ * the mean for shots and hunt times, absolute for the success ratio (0 to ignore).
+ * Intervals are computed over instance means, since the trials of a forest are not 
+ * independent. max_instances is a hard cap for each size.
+ */
+struct SweepPrecision
+{
+	double shots, success, time;
+	unsigned max_instances;
+
+	inline bool enabled() const { return shots > 0.0 || success > 0.0 || time > 0.0; }
+};
+
+
+
+/**
+ * Statistics of the results of one hunter, accumulated hunt by hunt in constant memory.
+ * Accumulators of different instances, threads or runs can be merged; shots and hunt
+ * times are only accounted for successful hunts.
  */
 struct ResultsStatistics 
 { 
-	double average, std, success_ratio; 
-	unsigned n_samples; int min, max;
+	uint64_t n_samples, n_success, n_censored;
+
+	// Number of shots of successful hunts, hunt times and set_forest times (in seconds)
+	StreamingStatistics shots, time, setup;
+
+	// Hardware events in set_forest and shoot (if counters are enabled)
+	PerfCounts setup_counters, shoot_counters;
+
+	// Means of each instance (shots and times only for instances with successes)
+	uint64_t n_instances;
+	StreamingStatistics instance_shots, instance_success, instance_time;
+
+	ResultsStatistics() { clear(); }
+
+	void clear();
+	void add_hunt( const int& count, const double& seconds );
+	void add_setup( const double& seconds );
+	void add_instance( const ResultsStatistics& instance );
+	void merge( const ResultsStatistics& other );
+
+	// Half-width of the 95% confidence interval on the mean of instance means
+	static inline double half_width( const StreamingStatistics& S )
+		{ return S.size() > 1 ? BENCHMARK_Z95 * S.std() / std::sqrt( (double) S.size() ) : 0.0; }
+
+	// Largest ratio between the half-widths of the intervals and their targets (<= 1 when precise enough)
+	double precision_ratio( const SweepPrecision& P ) const;
+
+	// Exact text serialization (on a single line, without newline)
+	void save( FILE *f ) const;
+	bool load( FILE *f );
+
+	inline double success_ratio() const 
+		{ return n_samples ? double(n_success) / n_samples : 0.0; }
+	inline double censored_ratio() const 
+		{ return n_samples ? double(n_censored) / n_samples : 0.0; }
+	inline double shot_time() const 
+		{ return shots.sum() > 0.0 ? time.sum() / shots.sum() : 0.0; }
+
+	void print( const char* name = "Unknown" ) const;
+};
+
 
-	double time_average, time_min, time_max;
 
-	void process( const std::vector<int>& results, const std::vector<double>& times );
+/**
+ * Compare the shot sequences of two hunters on the same forests.
+ * This is used to check that a cheaper variant of a strategy (e.g. Jonathan
+ * in single precision) produces the same plans as the reference one.
+ */
+struct PlanComparison
+{
+	unsigned n_instances, n_shots, n_divergent; 
+	unsigned first_min; double first_average;
+
+	void clear();
+	void process( const int& first_divergence );
 	void print( const char* name = "Unknown" ) const;
 };
 
 
 
 /**
- * This is where the two strategies compete to kill Bob.
+ * Configuration of one forest size in a sweep.
+ */
+struct SweepSize
+{
+	unsigned trees, instances, trials;
+};
+
+
+
+/**
+ * This is where the strategies compete to kill Bob.
  * A benchmark is setup with a fixed number of trees in the forest.
  * At each of the n_instances instance, a new random forest is generated, 
  * in which Bob is placed at a random location n_trial times, for each of
- * which both hunters compete to kill him.
+ * which all registered hunters compete to kill him. Every hunter faces the 
+ * same forests, and the same trajectories of Bob.
+ *
+ * Each hunt (a hunter in a trial) can be bounded by a number of shots and a wall-clock 
+ * time; the hunters who didn't kill Bob within these budgets are recorded as censored.
+ *
+ * Bob's trajectory is generated in blocks before the hunters shoot at it, and hunters
+ * shoot in batches (ChuckInterface::shoot_batch) of growing sizes, up to BENCHMARK_BLOCK; 
+ * the first shot that hit Bob is found with a vectorized comparison. Hunts and set_forest
+ * are timed with a Stopwatch; the time of the last batch is prorated to the shots fired
+ * until the kill, and shots are timed by dividing the hunt time by the number of shots.
+ *
+ * Instances run on a pool of threads, each of which works with its own clones of the 
+ * hunters. The random engine is reseeded at each instance from the seed of the 
+ * benchmark, the size and the instance index, and the statistics of each instance are 
+ * merged in the order of the instances as soon as all previous instances are done; 
+ * hence results don't depend on the number of threads, and memory doesn't grow with 
+ * the number of trials.
+ *
+ * With a target precision, each size is run in rounds: after each round, sizes whose
+ * confidence intervals are still too wide get more instances (with the next indices), up 
+ * to a hard cap. The rounds don't depend on the threads for targets on shots and success 
+ * ratios. A target on hunt times (--ci-time) makes the number of instances depend on the 
+ * times measured, hence on the machine, its load and the number of threads, so such a 
+ * sweep is not reproducible from its seed alone.
+ *
+ * Sweeps can be checkpointed in a file, atomically (written aside, then renamed). Since 
+ * each instance reseeds the random engine, the state of a sweep is made of its seed, 
+ * the instances merged so far and the merged statistics; a sweep that is restarted with
+ * the same configuration (and seed, if one is set) resumes from there and gives the same
+ * results. The checkpoint is removed once the sweep is complete, so that the next run 
+ * starts over.
+ *
+ * A sweep can also be split between processes: each shard runs every shard_count-th 
+ * (size, instance) pair of the first round (no target precision), and writes the 
+ * results of each of its instances to a partial file. merge_shards combines them in the 
+ * order of a single run, so the statistics of the hunts are exactly the same.
+ *
+ * Optionally, hardware events are counted in each phase (generation, set_forest, shoot 
+ * and walk) by the threads that run them; counters are read outside the timed sections.
  */
 class Benchmark
 {
@@ -96,38 +233,178 @@ public:
 
 	/********************     **********     ********************/
 
+	// Ctor
+	Benchmark() { clear(); }
+
 	// Clear all members
 	void clear();
 
 	// Is the benchmark ready to be run?
 	inline operator bool() const 
-	{ return angelo && jonathan && n_trees && n_instances*n_trials; }
+	{ return !hunters.empty() && n_trees && n_instances*n_trials; }
 
 	// Setup new benchmark
 	void setup( const unsigned& trees, const unsigned& instances, const unsigned& trials );
 
-	// Set hunters
-	void set_hunters( ChuckInterface *A, ChuckInterface *J );
+	// Register a new hunter, and return its index in the results
+	unsigned add_hunter( const char* name, ChuckInterface *chuck );
+
+	// Unregister all hunters
+	inline void clear_hunters() { hunters.clear(); }
+
+	// Registered hunters
+	inline unsigned n_hunters() const { return hunters.size(); }
+	inline const char* hunter_name( const unsigned& k ) const { return hunters[k].name; }
+
+	// Set budgets for each hunter in each trial (0 means unlimited)
+	void set_budget( const unsigned& shots, const double& seconds );
+
+	// Keep adding instances until the results are precise enough (see SweepPrecision)
+	inline void set_precision( const SweepPrecision& P ) { precision = P; }
+
+	// Start each trial of an instance at the next tree of a random permutation
+	inline void set_stratified( const bool& flag ) { stratified = flag; }
+
+	// Random graph model of the forests
+	inline void set_generator( const ForestGenerator& g ) { generator = g; }
+	inline const ForestGenerator& get_generator() const { return generator; }
 
-	// Run the benchmark
-	bool run( result_type& A, result_type& J );
+	// Law of Bob's jumps in the forests
+	inline void set_jumps( const JumpModel& j ) { jumps = j; }
+	inline const JumpModel& get_jumps() const { return jumps; }
+
+	// Count hardware events in each phase (see PerfCounters)
+	inline void set_counters( const bool& flag ) { counters = flag; }
+
+	// Hardware events of the phases shared by all hunters, for each size of the last sweep
+	inline const PerfCounts& generation_counters( const unsigned& s ) const { return generation[s]; }
+	inline const PerfCounts& walk_counters( const unsigned& s ) const { return walk[s]; }
+
+	// Software counters of the slow paths (see Counters), for each size of the last sweep
+	inline const CounterValues& event_counters( const unsigned& s ) const { return events[s]; }
+
+	// Save the progress of sweeps in a file every period seconds, and resume from it (empty to disable)
+	inline void set_checkpoint( const std::string& file, const double& period = BENCHMARK_CHECKPOINT_PERIOD ) 
+		{ checkpoint_file = file; checkpoint_period = period; }
+
+	// Run only the index-th of count shards of the sweeps, and write its results to a partial file
+	inline void set_shard( const unsigned& index, const unsigned& count, const std::string& file ) 
+		{ shard_index = index; shard_count = count; shard_file = file; }
+
+	// Number of threads (0 for one per hardware thread)
+	inline void set_threads( const unsigned& n ) { n_threads = n; }
+
+	// Seed of the random forests and trajectories (random unless set)
+	inline void set_seed( const uint64_t& s ) { seed = s; seeded = true; }
+	inline const uint64_t& get_seed() const { return seed; }
+
+	// Run the benchmark, results are in the order of registration
+	bool run( std::vector<result_type>& results );
+
+	// Run all (size, instance) pairs of a sweep on the same pool of threads
+	bool run_sweep( const std::vector<SweepSize>& sizes, std::vector< std::vector<result_type> >& results );
+
+	// Verify exactly the plans (up to max_shots) of each hunter on n_instances forests
+	bool verify( const unsigned& max_shots, std::vector<VerificationStatistics>& V );
+
+	// Exact capture-time distribution of the plans (up to max_shots) of each hunter
+	bool evaluate( const unsigned& max_shots, std::vector<EvaluationStatistics>& E );
+
+	// Combine the partial files of all shards of a sweep into its results
+	bool merge_shards( const std::vector<std::string>& files, const std::vector<SweepSize>& sizes, 
+		std::vector< std::vector<result_type> >& results );
+
+	// Compare the first n_shots of two hunters on n_instances forests
+	bool compare( ChuckInterface *reference, ChuckInterface *other, 
+		const unsigned& n_shots, PlanComparison& C );
 
 private:
 
+	// Registered hunter
+	struct Hunter
+	{
+		const char *name;
+		ChuckInterface *chuck;
+	};
+
+	// Results of one instance, for each hunter, events of the shared phases and software counters
+	struct InstanceResults
+	{
+		std::vector<result_type> hunters;
+		PerfCounts generation, walk;
+		CounterValues counters;
+	};
+
+	// State of each thread
+	struct Worker
+	{
+		JumpingMonkeyInstance instance;
+		std::vector< std::unique_ptr<ChuckInterface> > hunters;
+		std::vector<unsigned> trajectory;
+		std::vector<int> shots;
+		std::vector<unsigned> starts;
+		PerfCounters perf;
+		bool perf_opened, reserved;
+
+		Worker(): perf_opened(false), reserved(false) {}
+	};
+
+	// Configuration of a sweep in checkpoints and partial files
+	void save_header( FILE *f, const char *magic, const std::vector<SweepSize>& sizes ) const;
+	bool load_header( FILE *f, const char *magic, const std::vector<SweepSize>& sizes, uint64_t& s0 ) const;
+
+	// Close a file written aside, and rename it
+	static bool commit_file( FILE *f, const std::string& tmp, const std::string& name );
+
+	// Append the results of one instance to a partial file
+	void save_instance( FILE *f, const unsigned& s, const unsigned& i, const InstanceResults& R ) const;
+
+	// Save or restore the state of a sweep: merged results, and instances merged and to run
+	bool save_checkpoint( const std::vector<SweepSize>& sizes, const std::vector< std::vector<result_type> >& results, 
+		const std::vector<unsigned>& merged, const std::vector<unsigned>& last ) const;
+	bool load_checkpoint( const std::vector<SweepSize>& sizes, std::vector< std::vector<result_type> >& results, 
+		std::vector<unsigned>& merged, std::vector<unsigned>& last );
+
+	// Number of instances to reach the target precision for a size
+	unsigned next_instances( const std::vector<result_type>& R, const unsigned& done ) const;
+
+	// Reseed the random engine of the calling thread for an instance
+	void seed_instance( const unsigned& trees, const unsigned& index ) const;
+
+	// Reserve the storage of a worker for the largest forests of a sweep
+	void reserve( Worker& worker, const unsigned& trees ) const;
+
 	// Internal method to run one instance
-	void run_instance();
+	bool run_instance( Worker& worker, const SweepSize& size, InstanceResults& R ) const;
 
-	// Internal method to run one shooting
-	void run_shooting( ChuckInterface *chuck, const unsigned& bob, int& count, double& time, bool& killed );
+	// Internal method to run one hunt against Bob's trajectory
+	int run_hunt( Worker& worker, ChuckInterface *chuck, double& time, PerfCounts& shoot, PerfCounts& walk ) const;
 
 	// Members
 	// 
-	unsigned n_trees, n_instances, n_trials;
-	ChuckInterface *angelo, *jonathan;
+	unsigned n_trees, n_instances, n_trials, max_shots, n_threads;
+	double max_seconds;
+	uint64_t seed;
+	bool seeded;
+	ForestGenerator generator;
+	JumpModel jumps;
+	bool counters, stratified;
+	SweepPrecision precision;
+
+	std::string checkpoint_file;
+	double checkpoint_period;
+
+	unsigned shard_index, shard_count;
+	std::string shard_file;
+
+	std::vector<Hunter> hunters;
 	JumpingMonkeyInstance instance;
+	std::vector<PerfCounts> generation, walk;
+	std::vector<CounterValues> events;
 
-	std::vector<int> counts_angelo, counts_jonathan;
-	std::vector<double> time_angelo, time_jonathan;
+	PlanVerifier verifier;
+	PlanEvaluator evaluator;
+	plan_type plan;
 };
 
 
@@ -0,0 +1,480 @@
+#include "canonical.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+//=============================================
+// @filename     canonical.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [CanonicalForm::compute Compute the canonical labeling of a forest.]
+ * @param  forest [Any forest with at most CANONICAL_MAXSIZE trees.]
+ * @return        [False if the forest is too large or too symmetric.]
+ */
+bool CanonicalForm::compute( const Forest& forest )
+{
+	// Safety check
+	n = forest.size(); has_best = false; n_leaves = 0;
+	if ( !forest || n > CANONICAL_MAXSIZE ) return false;
+
+	// Get forest information
+	const Forest::vector_type& neighbors = forest.get_neighbors();
+	const Forest::array_type&  degrees   = forest.get_degrees();
+	const Forest::array_type&  strides   = forest.get_strides();
+
+	// Each individualization adds a cell, so the search is at most n deep
+	if ( level_color.size() < n+1 ) { level_color.resize(n+1); level_tried.resize(n+1); }
+	if ( signature.size() < n ) signature.resize(n);
+
+	// Adjacency rows as bitmasks, initial colors are the degrees
+	partition_type& color = level_color[0];
+	color.resize(n);
+	adjacency.assign( n, 0 );
+
+	for ( unsigned t = 0; t < n; ++t )
+	{
+		color[t] = degrees[t];
+		for ( unsigned d = 0; d < degrees[t]; ++d ) 
+			adjacency[t] |= uint64_t(1) << neighbors[ strides[t] + d ];
+	}
+
+	// Explore the search tree
+	search(0);
+	if ( !has_best || n_leaves > CANONICAL_MAXLEAVES ) return false;
+
+	// Inverse labeling
+	best_inverse.resize(n);
+	for ( unsigned t = 0; t < n; ++t ) best_inverse[ best_labeling[t] ] = t;
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [CanonicalForm::reserve Reserve the storage of forests with up to n trees, so that 
+ * computing their canonical form doesn't allocate.]
+ * @param n [Max number of trees.]
+ */
+void CanonicalForm::reserve( const unsigned& n )
+{
+	adjacency.reserve(n); best_key.reserve(n); leaf_key.reserve(n);
+	best_labeling.reserve(n); best_inverse.reserve(n);
+	order.reserve(n); cell_size.reserve(n);
+
+	// The search is at most n deep, and the colors of a child are below 2n (see search)
+	if ( level_color.size() < n+1 ) { level_color.resize(n+1); level_tried.resize(n+1); }
+	if ( signature.size() < n ) signature.resize(n);
+
+	for ( unsigned d = 0; d <= n; ++d ) { level_color[d].reserve(n); level_tried[d].reserve(n); }
+	for ( unsigned t = 0; t < n; ++t ) signature[t].reserve( 2*n+1 );
+}
+
+
+
+/**
+ * [CanonicalForm::refine Refine a partition until it is equitable.]
+ * The new colors are ordered by (old color, number of neighbors in each color), which 
+ * doesn't depend on the labels of the trees. Colors are dense on output.
+ * @param color [Color of each tree.]
+ */
+void CanonicalForm::refine( partition_type& color )
+{
+	// Signature of each tree: old color, then the number of neighbors of each color
+	order.resize(n);
+
+	unsigned n_colors = 0;
+	for ( bool changed = true; changed; )
+	{
+		// Current number of colors (colors might not be dense on input)
+		const unsigned max_color = *std::max_element( color.begin(), color.end() );
+
+		for ( unsigned t = 0; t < n; ++t )
+		{
+			signature[t].assign( max_color+2, 0 );
+			signature[t][0] = color[t];
+
+			for ( uint64_t a = adjacency[t]; a; a &= a-1 )
+				++signature[t][ 1 + color[ __builtin_ctzll(a) ] ];
+		}
+
+		// Sort trees by signature
+		for ( unsigned t = 0; t < n; ++t ) order[t] = t;
+		std::sort( order.begin(), order.end(), 
+			[this]( const unsigned& a, const unsigned& b ){ return signature[a] < signature[b]; } );
+
+		// Assign dense colors
+		unsigned c = 0;
+		for ( unsigned k = 0; k < n; ++k )
+		{
+			if ( k && signature[order[k]] != signature[order[k-1]] ) ++c;
+			color[ order[k] ] = c;
+		}
+
+		// Stop when the number of colors is stable
+		changed = (c+1 != n_colors); n_colors = c+1;
+	}
+}
+
+
+
+/**
+ * [CanonicalForm::search Recursive individualization-refinement.]
+ * @param depth [Depth of the current node of the search tree, whose partition is 
+ *              level_color[depth] (refined in place).]
+ */
+void CanonicalForm::search( const unsigned& depth )
+{
+	// Give up if the search is too large
+	if ( n_leaves > CANONICAL_MAXLEAVES ) return;
+
+	// Refine partition
+	partition_type& color = level_color[depth]; refine(color);
+
+	// Find the first non-singleton cell
+	cell_size.assign( n, 0 );
+	for ( unsigned t = 0; t < n; ++t ) ++cell_size[ color[t] ];
+
+	unsigned target = 0;
+	while ( target < n && cell_size[target] < 2 ) ++target;
+
+	// Discrete partition: compare the relabeled adjacency to the best one
+	if ( target == n )
+	{
+		++n_leaves;
+
+		leaf_key.assign( n, 0 );
+		for ( unsigned t = 0; t < n; ++t )
+		for ( uint64_t a = adjacency[t]; a; a &= a-1 )
+			leaf_key[ color[t] ] |= uint64_t(1) << color[ __builtin_ctzll(a) ];
+
+		if ( !has_best || leaf_key < best_key )
+		{
+			has_best = true;
+			best_key = leaf_key;
+			best_labeling = color;
+		}
+		return;
+	}
+
+	// Individualize each tree of the target cell (but only one tree per class of twins)
+	std::vector<unsigned>& tried = level_tried[depth];
+	partition_type& child = level_color[depth+1];
+	tried.clear(); child.resize(n);
+
+	for ( unsigned v = 0; v < n; ++v ) if ( color[v] == target )
+	{
+		bool twin = false;
+		for ( auto u = tried.begin(); !twin && u != tried.end(); ++u )
+		{
+			const uint64_t bu = uint64_t(1) << *u, bv = uint64_t(1) << v;
+			twin = (adjacency[*u] & ~bv) == (adjacency[v] & ~bu);
+		}
+		if ( twin ) continue;
+		tried.push_back(v);
+
+		// v comes first in its cell
+		for ( unsigned t = 0; t < n; ++t ) 
+			child[t] = (color[t] << 1) + ( color[t] == target && t != v );
+
+		search(depth+1);
+	}
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [PlanCache::clear Remove all entries and reset counters.]
+ */
+void PlanCache::clear()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	entries.clear(); key_pool.clear(); plan_pool.clear();
+	table.clear();
+	n_hits = n_misses = 0;
+}
+
+
+
+/**
+ * [PlanCache::reserve Make room for more entries, so that inserting them doesn't allocate.]
+ * @param n_entries [Number of entries to come.]
+ * @param n_trees   [Total number of trees of their forests.]
+ * @param n_shots   [Total length of their plans.]
+ */
+void PlanCache::reserve( const unsigned& n_entries, const unsigned& n_trees, const unsigned& n_shots )
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	entries.reserve( entries.size() + n_entries );
+	key_pool.reserve( key_pool.size() + n_trees );
+	plan_pool.reserve( plan_pool.size() + n_shots );
+
+	// Keep load factor below 1/2
+	std::size_t capacity = table.size() ? table.size() : 64;
+	while ( capacity < (entries.size() + n_entries) << 1 ) capacity <<= 1;
+
+	if ( capacity > table.size() ) rehash( capacity );
+}
+
+
+
+/**
+ * [PlanCache::find Look for the plan of a forest given its canonical form.]
+ * @param  form       [Canonical form of the forest.]
+ * @param  plan       [Output shot sequence, in the labels of the forest.]
+ * @param  impossible [Output verdict.]
+ * @return            [True if the forest was found in the cache.]
+ */
+bool PlanCache::find( const CanonicalForm& form, plan_type& plan, bool& impossible )
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	const CanonicalForm::key_type& key = form.key();
+	const std::size_t slot = table.empty() ? 0 : lookup( &key[0], key.size() );
+	if ( table.empty() || !table[slot] ) { ++n_misses; return false; }
+
+	// Remap the plan from canonical labels
+	const Entry& entry = entries[ table[slot]-1 ];
+	const CanonicalForm::labeling_type& inverse = form.inverse();
+
+	plan.resize( entry.length );
+	for ( unsigned k = 0; k < entry.length; ++k ) 
+		plan[k] = inverse[ plan_pool[ entry.plan + k ] ];
+
+	impossible = entry.impossible;
+
+	++n_hits; return true;
+}
+
+
+
+/**
+ * [PlanCache::insert Store the plan of a forest.]
+ * Plans only depend on the canonical form, so if another thread stored the same form in 
+ * the meantime, its entry is kept.
+ * @param form       [Canonical form of the forest.]
+ * @param plan       [Shot sequence, in the labels of the forest.]
+ * @param impossible [Verdict.]
+ */
+void PlanCache::insert( const CanonicalForm& form, const plan_type& plan, const bool& impossible )
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	// Keep load factor below 1/2
+	if ( (entries.size() + 1) << 1 > table.size() ) rehash( table.size() ? table.size() << 1 : 64 );
+
+	const CanonicalForm::key_type& key = form.key();
+	const std::size_t slot = lookup( &key[0], key.size() );
+	if ( table[slot] ) return;
+
+	append( &key[0], key.size(), impossible, slot );
+
+	// Store the plan in canonical labels
+	const CanonicalForm::labeling_type& labeling = form.labeling();
+
+	for ( unsigned k = 0; k < plan.size(); ++k ) 
+		plan_pool.push_back( labeling[ plan[k] ] );
+	entries.back().length = plan.size();
+}
+
+
+
+/**
+ * [PlanCache::lookup Probe the table for the canonical rows of a forest.]
+ * @param  key [Canonical rows.]
+ * @param  n   [Number of trees.]
+ * @return     [Slot of the entry with these rows, or the first empty slot on the way.]
+ */
+std::size_t PlanCache::lookup( const uint64_t *key, const unsigned& n ) const
+{
+	uint64_t h = mix64(n);
+	for ( unsigned k = 0; k < n; ++k ) h = mix64( h ^ key[k] );
+
+	// Linear probing
+	const std::size_t mask = table.size() - 1;
+	for ( std::size_t slot = h & mask; ; slot = (slot+1) & mask )
+	{
+		if ( !table[slot] ) return slot;
+
+		const Entry& entry = entries[ table[slot]-1 ];
+		if ( entry.n_trees == n && std::equal( key, key + n, key_pool.begin() + entry.key ) ) return slot;
+	}
+}
+
+
+
+/**
+ * [PlanCache::rehash Change the number of slots of the table and reinsert the entries.]
+ * @param capacity [Number of slots, a power of two (at least twice the number of entries).]
+ */
+void PlanCache::rehash( const std::size_t& capacity )
+{
+	table.assign( capacity, 0 );
+
+	for ( unsigned i = 0; i < entries.size(); ++i ) 
+		table[ lookup( &key_pool[ entries[i].key ], entries[i].n_trees ) ] = i+1;
+}
+
+
+
+/**
+ * [PlanCache::append Append an entry with the given rows, and an empty plan at the end of 
+ * the pool (the caller appends the shots and sets the length).]
+ * @param key        [Canonical rows.]
+ * @param n          [Number of trees.]
+ * @param impossible [Verdict.]
+ * @param slot       [Empty slot of the table for these rows, see lookup.]
+ */
+void PlanCache::append( const uint64_t *key, const unsigned& n, const bool& impossible, const std::size_t& slot )
+{
+	const Entry entry = { (unsigned) key_pool.size(), n, (unsigned) plan_pool.size(), 0, impossible };
+
+	key_pool.insert( key_pool.end(), key, key + n );
+	entries.push_back( entry );
+	table[slot] = entries.size();
+}
+
+
+
+/**
+ * [PlanCache::load Read entries from a text file, written by save().]
+ * The first line is "plans" and the version of the format (files of other versions hold
+ * plans computed differently, and are ignored). Then each line is: 
+ * n_trees impossible plan_length rows(hex)... plan...
+ * Entries are checked (size, rows and shots within the trees); reading stops at the 
+ * first invalid entry, and the entries read before are kept.
+ * @param  filename [Path to the cache file.]
+ * @return          [False if the file could not be read, or is invalid.]
+ */
+bool PlanCache::load( const char* filename )
+{
+	FILE *file = fopen( filename, "r" );
+	if ( !file ) return false;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	unsigned n, length, version; int impossible; char magic[16];
+	CanonicalForm::key_type key;
+	plan_type plan;
+
+	bool ok = fscanf( file, "%15s %u", magic, &version ) == 2 && !strcmp( magic, "plans" ) && 
+		version == CANONICAL_CACHE_VERSION;
+
+	while ( ok && fscanf( file, "%u %d %u", &n, &impossible, &length ) == 3 )
+	{
+		ok = n >= 1 && n <= CANONICAL_MAXSIZE && (impossible == 0 || impossible == 1);
+		if ( !ok ) break;
+
+		// Read canonical adjacency (no tree beyond n)
+		const uint64_t trees = n < 64 ? (uint64_t(1) << n) - 1 : ~uint64_t(0);
+
+		key.resize(n);
+		for ( unsigned k = 0; ok && k < n; ++k ) 
+		{
+			unsigned long long row;
+			ok = fscanf( file, "%llx", &row ) == 1 && !(row & ~trees); key[k] = row;
+		}
+
+		// Read plan (the file bounds its length, shots are trees)
+		plan.clear();
+		for ( unsigned k = 0; ok && k < length; ++k ) 
+		{
+			int shot;
+			ok = fscanf( file, "%d", &shot ) == 1 && shot >= 0 && shot < (int) n;
+			plan.push_back(shot);
+		}
+		if ( !ok ) break;
+
+		// Keep the first entry of each form
+		if ( (entries.size() + 1) << 1 > table.size() ) rehash( table.size() ? table.size() << 1 : 64 );
+
+		const std::size_t slot = lookup( &key[0], n );
+		if ( table[slot] ) continue;
+
+		append( &key[0], n, impossible, slot );
+		plan_pool.insert( plan_pool.end(), plan.begin(), plan.end() );
+		entries.back().length = length;
+	}
+
+	ok = ok && !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+
+
+/**
+ * [PlanCache::save Write all entries to a text file.]
+ * Entries are sorted by canonical rows, so that the file doesn't depend on the order in
+ * which the threads inserted them. The file is written aside and renamed, so that an 
+ * interrupted run leaves the previous one.
+ * @param  filename [Path to the cache file.]
+ * @return          [False if the file could not be written.]
+ */
+bool PlanCache::save( const char* filename ) const
+{
+	const std::string tmp = std::string(filename) + ".tmp";
+	FILE *file = fopen( tmp.c_str(), "w" );
+	if ( !file ) return false;
+
+	std::lock_guard<std::mutex> guard(lock);
+
+	// Order of the entries
+	std::vector<unsigned> order( entries.size() );
+	for ( unsigned i = 0; i < order.size(); ++i ) order[i] = i;
+
+	std::sort( order.begin(), order.end(), [this]( const unsigned& a, const unsigned& b )
+	{
+		auto ka = key_pool.begin() + entries[a].key, kb = key_pool.begin() + entries[b].key;
+		return std::lexicographical_compare( ka, ka + entries[a].n_trees, kb, kb + entries[b].n_trees );
+	});
+
+	fprintf( file, "plans %d\n", CANONICAL_CACHE_VERSION );
+	for ( auto it = order.cbegin(); it != order.cend(); ++it )
+	{
+		const Entry& entry = entries[*it];
+		fprintf( file, "%u %d %u", entry.n_trees, (int) entry.impossible, entry.length );
+
+		for ( unsigned k = 0; k < entry.n_trees; ++k ) 
+			fprintf( file, " %llx", (unsigned long long) key_pool[ entry.key + k ] );
+
+		for ( unsigned k = 0; k < entry.length; ++k ) 
+			fprintf( file, " %d", plan_pool[ entry.plan + k ] );
+
+		fprintf( file, "\n" );
+	}
+
+	bool ok = fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+	ok = ok && fsync( fileno(file) ) == 0;
+#endif
+	ok = (fclose(file) == 0) && ok;
+
+	return ok && rename( tmp.c_str(), filename ) == 0;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
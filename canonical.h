@@ -0,0 +1,172 @@
+#ifndef __CANONICAL__
+#define __CANONICAL__
+
+//=============================================
+// @filename     canonical.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "forest.h"
+
+#define CANONICAL_MAXSIZE 64
+#define CANONICAL_MAXLEAVES 4096
+#define CANONICAL_CACHE_VERSION 2
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Canonical labeling of a forest by individualization-refinement.
+ *
+ * The partition of the trees is refined until it is equitable (each tree of a cell has
+ * the same number of neighbors in every other cell), starting from the degrees. If the
+ * partition is not discrete, each tree of the first non-singleton cell is individualized
+ * in turn and the search recurses. The canonical form is the smallest adjacency matrix
+ * among the leaves of the search tree. Trees with the same neighbors (twins) are swapped
+ * by an automorphism, so only one of them is individualized.
+ *
+ * Highly symmetric forests can have too many leaves; the labeling then fails and should
+ * simply not be used (see CANONICAL_MAXLEAVES).
+ */
+class CanonicalForm
+{
+public:
+
+	typedef std::vector<uint64_t> key_type;
+	typedef std::vector<unsigned> labeling_type;
+
+	/********************     **********     ********************/
+
+	// Compute the canonical form of a forest with at most CANONICAL_MAXSIZE trees
+	bool compute( const Forest& forest );
+
+	// Reserve the storage of forests with up to n trees
+	void reserve( const unsigned& n );
+
+	// Canonical adjacency rows (the same for all isomorphic forests)
+	inline const key_type& key() const { return best_key; }
+
+	// Canonical label of each tree, and its inverse
+	inline const labeling_type& labeling() const { return best_labeling; }
+	inline const labeling_type& inverse() const { return best_inverse; }
+
+	// Number of trees
+	inline unsigned size() const { return n; }
+
+private:
+
+	typedef std::vector<unsigned> partition_type;
+
+	// Refine the colors until the partition is equitable
+	void refine( partition_type& color );
+
+	// Explore the search tree from the partition of a node at the given depth
+	void search( const unsigned& depth );
+
+	// Members
+	// 
+	key_type adjacency, best_key, leaf_key;
+	labeling_type best_labeling, best_inverse;
+
+	// Scratch space, which keeps its storage from one forest to the next: partition and 
+	// twins tried at each depth of the search, and signatures of the refinement
+	std::vector<partition_type> level_color, level_tried;
+	std::vector< std::vector<unsigned> > signature;
+	std::vector<unsigned> order, cell_size;
+
+	unsigned n, n_leaves;
+	bool has_best;
+};
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Persistent cache of plans, keyed by the canonical form of the forests.
+ * Plans are stored in canonical labels, and remapped to the labels of the 
+ * forest at hand when they are retrieved. The cache can be shared between threads.
+ *
+ * The canonical rows and the plans of the entries are stored back to back in two pools,
+ * and found through an open-addressing table, so that once reserved for the forests to
+ * come (see reserve), inserting a plan doesn't allocate.
+ */
+class PlanCache
+{
+public:
+
+	typedef std::vector<int> plan_type;
+
+	/********************     **********     ********************/
+
+	// Ctor
+	PlanCache() : n_hits(0), n_misses(0) {}
+
+	// Clear all entries and counters
+	void clear();
+
+	// Make room for more entries, with a total of n_trees canonical rows and n_shots shots
+	void reserve( const unsigned& n_entries, const unsigned& n_trees, const unsigned& n_shots );
+
+	// Find the plan (in the forest's labels) corresponding to a canonical form
+	bool find( const CanonicalForm& form, plan_type& plan, bool& impossible );
+
+	// Insert a plan (in the forest's labels)
+	void insert( const CanonicalForm& form, const plan_type& plan, const bool& impossible );
+
+	// Read/write entries from/to a text file
+	bool load( const char* filename );
+	bool save( const char* filename ) const;
+
+	// Statistics
+	inline unsigned size() const { return entries.size(); }
+	inline unsigned hits() const { return n_hits; }
+	inline unsigned misses() const { return n_misses; }
+
+private:
+
+	// Ranges of the canonical rows and of the plan of an entry in the pools
+	struct Entry
+	{
+		unsigned key, n_trees, plan, length;
+		bool impossible;
+	};
+
+	// Slot of the entry with the given rows in the table, or the empty slot where it would go
+	std::size_t lookup( const uint64_t *key, const unsigned& n ) const;
+
+	// Change the number of slots (a power of two), and reinsert the entries
+	void rehash( const std::size_t& capacity );
+
+	// Append an entry, with an empty plan, in an empty slot of the table
+	void append( const uint64_t *key, const unsigned& n, const bool& impossible, const std::size_t& slot );
+
+	// Members (table holds the index of an entry plus one, or 0 for empty slots)
+	// 
+	std::vector<Entry> entries;
+	std::vector<uint64_t> key_pool;
+	std::vector<int> plan_pool;
+	std::vector<unsigned> table;
+	unsigned n_hits, n_misses;
+	mutable std::mutex lock;
+};
+
+#endif
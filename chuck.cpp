@@ -17,52 +17,221 @@
 
 
 /**
- * [Jonathan::clear Clear all member data.]
+ * [ThresholdRescaling::normalize Scale the table if the max probability falls below CHUCK_EPSILON.]
+ * @param  pi     [Table to normalize (the new distribution).]
+ * @param  n      [Size of the table.]
+ * @param  pi_max [Max value in the table.]
+ * @return        [True if the table was rescaled.]
  */
-void Jonathan::clear()
+template <class T>
+bool ThresholdRescaling::normalize( T *pi, const unsigned& n, const T& pi_max )
+{
+	if ( pi_max > CHUCK_EPSILON ) return false;
+
+	// NOTE: the other table is overwritten at the next shot, no need to scale it
+	for ( unsigned t = 0; t < n; ++t ) pi[t] /= CHUCK_EPSILON;
+	return true;
+}
+
+
+
+/**
+ * [ShotRenormalization::normalize Divide the table by its max probability.]
+ * @param  pi     [Table to normalize (the new distribution).]
+ * @param  n      [Size of the table.]
+ * @param  pi_max [Max value in the table.]
+ * @return        [True if the table was rescaled.]
+ */
+template <class T>
+bool ShotRenormalization::normalize( T *pi, const unsigned& n, const T& pi_max )
+{
+	if ( pi_max <= T(0) ) return false;
+
+	const T scale = T(1) / pi_max;
+	for ( unsigned t = 0; t < n; ++t ) pi[t] *= scale;
+	return true;
+}
+
+
+
+/**
+ * [ExponentTracking::normalize Multiply the table by a power of two when the max probability 
+ * gets small. The scaling is exact, so it doesn't introduce any rounding.]
+ * @param  pi     [Table to normalize (the new distribution).]
+ * @param  n      [Size of the table.]
+ * @param  pi_max [Max value in the table.]
+ * @return        [True if the table was rescaled.]
+ */
+template <class T>
+bool ExponentTracking::normalize( T *pi, const unsigned& n, const T& pi_max )
+{
+	// Lazy threshold, half-way to the smallest normal exponent
+	static const T threshold = std::ldexp( T(1), std::numeric_limits<T>::min_exponent/2 );
+	if ( pi_max <= T(0) || pi_max > threshold ) return false;
+
+	// Bring the max back to [0.5,1)
+	int e; std::frexp( pi_max, &e );
+	for ( unsigned t = 0; t < n; ++t ) pi[t] = std::ldexp( pi[t], -e );
+
+	exponent += e;
+	return true;
+}
+
+
+
+/**
+ * [LogDomain::normalize Subtract the max log-probability when it gets too small.]
+ * @param  pi     [Table to normalize (the new distribution).]
+ * @param  n      [Size of the table.]
+ * @param  pi_max [Max value in the table.]
+ * @return        [True if the table was rescaled.]
+ */
+template <class T>
+bool LogDomain::normalize( T *pi, const unsigned& n, const T& pi_max )
+{
+	// Keep magnitudes small to preserve absolute precision
+	if ( pi_max == zero<T>() || pi_max > T(-64) ) return false;
+
+	for ( unsigned t = 0; t < n; ++t ) pi[t] -= pi_max;
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [BasicJonathan::clear Clear all member data.]
+ */
+template <class T, class N>
+void BasicJonathan<T,N>::clear()
 {
 	// Disable pointers
 	pi_new = pi_old = nullptr;
 
 	// Clear arrays
-	degrees.~valarray();
-	neighbors.~valarray();
+	degrees.clear();
+	neighbors.clear();
+	weights.clear();
+	support_keys.clear();
+
+	colors.clear();
+	class_rows.clear();
+	class_degrees.clear();
+	class_neighbors.clear();
+	class_weights.clear();
+	bipartite = false; live_class = -1;
 
-	array_a.~valarray();
-	array_b.~valarray();
+	parts.clear();
+	part_state.clear(); part_live.clear();
+	n_parts = 0;
+
+	array_a.clear();
+	array_b.clear();
 
 	// Scalars
 	next_shot = n_nodes = n_edges = 0;
+	visited.clear(); stuck = false;
+}
+
+
+
+/**
+ * [BasicJonathan::clone Copy settings and forest. The clone is ready for a new hunt.]
+ * @return [New hunter owned by the caller.]
+ */
+template <class T, class N>
+BasicJonathan<T,N>* BasicJonathan<T,N>::clone() const
+{
+	BasicJonathan *chuck = new BasicJonathan(*this);
+
+	// Pointers to tables must be reset
+	if ( n_nodes ) chuck->restart(); 
+	else chuck->pi_new = chuck->pi_old = nullptr;
+
+	return chuck;
 }
 
 
 
 /**
- * [Jonathan::set_forest Introduce Chuck to the forest.]
+ * [BasicJonathan::set_forest Introduce Chuck to the forest.]
  * @param  forest [Freshly generated forest.]
  * @return        [Initialization success.]
  */
-bool Jonathan::set_forest( const Forest& forest )
+template <class T, class N>
+bool BasicJonathan<T,N>::set_forest( const Forest& forest )
 {
 	// Safety check
 	if ( !forest ) return false;
 
 	// Set scalar properties first
-	next_shot = 0;
 	n_nodes   = forest.size();
 	n_edges   = forest.get_neighbors().size();
 
 	// Copy degrees and neighbors
-	degrees   = forest.get_degrees(); // Note: std requires to resize first, but gcc is a big boy.
-	neighbors = std::valarray<unsigned>( forest.get_neighbors().data(), n_edges );
+	degrees.assign( std::begin(forest.get_degrees()), std::end(forest.get_degrees()) );
+	neighbors.assign( forest.get_neighbors().begin(), forest.get_neighbors().end() );
+
+	// Transition weight from each neighbor, in the representation of the policy
+	weights.resize(n_edges);
+	if ( forest.weighted() )
+	{
+		// Probability of the opposite jump
+		const std::vector<double>&   jumps   = forest.get_jumps();
+		const Forest::vector_type&   reverse = forest.get_reverse();
+		for ( unsigned e = 0; e < n_edges; ++e ) 
+			weights[e] = N::template weight<T>( jumps[ reverse[e] ] );
+	}
+	else for ( unsigned e = 0; e < n_edges; ++e ) 
+		weights[e] = N::template weight<T>( degrees[ neighbors[e] ] );
+
+	// Split the rows in two classes on bipartite forests
+	bipartite = forest.bipartite();
+	colors.assign( n_nodes, 0 );
+
+	if ( bipartite )
+	{
+		const Forest::vector_type& F_colors  = forest.get_colors();
+		const Forest::array_type&  F_strides = forest.get_strides();
+
+		class_rows.resize(n_nodes); class_degrees.resize(n_nodes);
+		class_neighbors.resize(n_edges); class_weights.resize(n_edges);
+
+		unsigned i = 0, e = 0;
+		for ( unsigned c = 0; c < 2; ++c )
+		{
+			class_start[c] = i; edge_start[c] = e;
+
+			for ( unsigned t = 0; t < n_nodes; ++t ) if ( (colors[t] = F_colors[t]) == c )
+			{
+				class_rows[i] = t; class_degrees[i++] = degrees[t];
+
+				for ( unsigned f = F_strides[t]; f < F_strides[t+1]; ++f, ++e )
+				{
+					class_neighbors[e] = neighbors[f];
+					class_weights[e]   = weights[f];
+				}
+			}
+		}
+		class_start[2] = i; edge_start[2] = e;
+	}
+
+	// Connected parts
+	n_parts = forest.get_n_components();
+	parts.resize( n_nodes );
+	for ( unsigned t = 0; t < n_nodes; ++t ) parts[t] = forest.get_components()[t];
+
+	// Zobrist keys to hash the support of the distribution
+	support_keys.resize(n_nodes);
+	for ( unsigned t = 0; t < n_nodes; ++t ) support_keys[t] = mix64(t);
 
 	// Load gun
 	restart();
 
-	// Set distributions pointers
-	pi_new = &array_a[0];
-	pi_old = &array_b[0];
-
 	// Report success
 	return true;
 }
@@ -70,14 +239,40 @@ bool Jonathan::set_forest( const Forest& forest )
 
 
 /**
- * [Jonathan::swap_pointers This is a trick to avoid copying each time pi_new to pi_old. 
+ * [BasicJonathan::reserve Reserve the tables of forests with up to n_trees trees, and the 
+ * states visited in hunts of up to n_shots shots.]
+ * @param n_trees [Max number of trees.]
+ * @param n_shots [Max number of shots of a hunt (0 if there is no budget).]
+ */
+template <class T, class N>
+void BasicJonathan<T,N>::reserve( const unsigned& n_trees, const unsigned& n_shots )
+{
+	// Each edge appears twice in the neighbors
+	const unsigned n = n_trees, n_entries = n ? n*(n-1) : 0;
+
+	degrees.reserve(n); neighbors.reserve(n_entries); weights.reserve(n_entries);
+	array_a.reserve(n); array_b.reserve(n); support_keys.reserve(n);
+
+	colors.reserve(n); class_rows.reserve(n); class_degrees.reserve(n);
+	class_neighbors.reserve(n_entries); class_weights.reserve(n_entries);
+	parts.reserve(n); part_state.reserve(n); part_live.reserve(n);
+
+	// Each shot visits at most one new state
+	if ( patience ) visited.reserve(n_shots);
+}
+
+
+
+/**
+ * [BasicJonathan::swap_pointers This is a trick to avoid copying each time pi_new to pi_old. 
  * Instead, pointers are swapped just before the update. That way, we virtually replace 
  * the old-old distribution with the old-new (which becomes the new-old), and clear the 
  * old-old to store the new-new. Got it? If yes, frankly cheers. ;)]
  */
-void Jonathan::swap_pointers()
+template <class T, class N>
+void BasicJonathan<T,N>::swap_pointers()
 {
-	double *ptr = pi_old;
+	T *ptr = pi_old;
 	pi_old = pi_new;
 	pi_new = ptr;
 }
@@ -85,65 +280,247 @@ void Jonathan::swap_pointers()
 
 
 /**
- * [Jonathan::reload Reset tables to uniform probability distributions.]
+ * [BasicJonathan::restart Reset tables to uniform probability distributions.]
  */
-void Jonathan::restart()
+template <class T, class N>
+void BasicJonathan<T,N>::restart()
 {
-	array_a.resize(n_nodes, (1.0/n_nodes) );
-	array_b.resize(n_nodes, (1.0/n_nodes) );
+	array_a.assign( n_nodes, N::template uniform<T>(n_nodes) );
+	array_b.assign( n_nodes, N::template uniform<T>(n_nodes) );
+
+	// Set distributions pointers (assign may reallocate)
+	pi_new = &array_a[0];
+	pi_old = &array_b[0];
+
+	// The first shot of every hunt is the argmax of the uniform distribution
+	next_shot = 0;
+	normalization.reset();
+
+	// Forget visited states
+	visited.clear(); stuck = false;
+
+	// Bob can be in both classes, and in all parts
+	live_class = -1; stale = false;
+	part_state.assign( n_parts, PART_LIVE );
+	part_live.assign( n_parts, 0 );
 }
 
 
 
 /**
- * [Jonathan::shoot Shoot the darn monkey.]
+ * [BasicJonathan::shoot Shoot the darn monkey.]
+ * Chuck is stuck when the support of the distribution and the next shot come back to 
+ * a state that was already visited more than patience*n times; the shot sequence has
+ * then most likely entered a cycle which does not reduce the set of possible positions 
+ * of Bob. Visits are not counted once the support is empty (Bob is necessarily dead).
  * @return [The chosen tree (that sounds like Avatar..). If Chuck is stuck, dial -1.]
  */
-int Jonathan::shoot()
+template <class T, class N>
+int BasicJonathan<T,N>::shoot()
 {
+	// Give up
+	if ( stuck ) return -1;
+
 	// Remember current shot
 	const unsigned tree = next_shot;
 
 	// Trick to avoid testing for the tree being shot
-	swap_pointers(); pi_old[ tree ] = 0.0;
+	swap_pointers(); pi_old[ tree ] = N::template zero<T>();
 
 	// Find new max probability
-	register double pi_max = 0.0; 
+	T pi_max = N::template zero<T>(); 
+	uint64_t support = 0;
+
+	// Are there several parts to keep track of?
+	const bool split = n_parts > 1;
+
+	if ( live_class < 0 )
+	{
+		// Classes where Bob can be
+		const unsigned live = split ? full_sweep<true>( pi_max, support ) : full_sweep<false>( pi_max, support );
+
+		// From now on, Bob's class alternates
+		if ( bipartite && (live == 1 || live == 2) ) { live_class = live >> 1; stale = true; }
+	}
+	else
+	{
+		// Bob has jumped to the other class
+		const unsigned c = live_class = 1 - live_class;
+
+		// Iterators on neighbors and transition weights of the class
+		const unsigned *neighbor = &class_neighbors[ edge_start[c] ];
+		const T *weight = &class_weights[ edge_start[c] ];
+
+		// Compute new probability distribution in the class
+		for ( unsigned i = class_start[c]; i < class_start[c+1]; ++i )
+		{
+			const unsigned t = class_rows[i];
+
+			// Skip the parts where Bob cannot be
+			if ( split && part_state[ parts[t] ] != PART_LIVE )
+			{
+				if ( part_state[ parts[t] ] == PART_CLEARED ) pi_new[t] = N::template zero<T>();
+				neighbor += class_degrees[i]; weight += class_degrees[i];
+				continue;
+			}
+
+			// Update probability
+			T pi = N::template zero<T>();
+			for ( unsigned d = 0; d++ < class_degrees[i]; ++neighbor, ++weight )
+				N::accumulate( pi, pi_old[ *neighbor ], *weight );
+
+			// Hash the support
+			if ( pi != N::template zero<T>() ) 
+			{
+				support ^= support_keys[t];
+				if ( split ) part_live[ parts[t] ] = 1; 
+			}
+
+			// Select tree with max probability for the next shot (same ties as above)
+			if ( (pi_new[t] = pi) > pi_max )
+			{ 
+				next_shot = t; 
+				pi_max    = pi; 
+			}
+		}
+
+		// The other class still holds the distribution of two jumps ago
+		if ( stale )
+		{
+			for ( unsigned i = class_start[1-c]; i < class_start[2-c]; ++i ) 
+				pi_new[ class_rows[i] ] = N::template zero<T>();
+			stale = false;
+		}
+	}
+
+	// Parts without probability are skipped from now on
+	if ( split ) update_parts();
+
+	// If max has become too small, scale tables
+	if ( normalization.normalize( pi_new, n_nodes, pi_max ) ) Counters::add( COUNTER_RESCALES );
+
+	// Detect cycles in the sequence of states
+	if ( patience && support && visited.increment( support ^ mix64(~next_shot) ) > patience*n_nodes ) 
+		stuck = true;
+
+	// Return current shot
+	return (int) tree;
+}
+
+
 
-	// Iterator on neighbors
+/**
+ * [BasicJonathan::full_sweep Compute the new distribution on all the trees.]
+ * Split is true when the forest has several parts to keep track of; the single part case 
+ * is compiled without the tests on the parts.
+ * @param  pi_max  [Input/output max probability, the next shot is updated accordingly.]
+ * @param  support [Input/output hash of the support.]
+ * @return         [Mask of the classes where Bob can be.]
+ */
+template <class T, class N>
+template <bool Split>
+unsigned BasicJonathan<T,N>::full_sweep( T& pi_max, uint64_t& support )
+{
+	// Iterators on neighbors and transition weights
 	const unsigned *neighbor = &neighbors[0];
+	const T *weight = &weights[0];
+
+	// Classes where Bob can be
+	unsigned live = 0;
 
 	// Compute new probability distribution
 	for ( unsigned t = 0; t < n_nodes; ++t )
 	{
+		// Skip the parts where Bob cannot be
+		if ( Split && part_state[ parts[t] ] != PART_LIVE )
+		{
+			if ( part_state[ parts[t] ] == PART_CLEARED ) pi_new[t] = N::template zero<T>();
+			neighbor += degrees[t]; weight += degrees[t];
+			continue;
+		}
+
 		// Reset probability
-		pi_new[t] = 0.0;
+		T pi = N::template zero<T>();
 
 		// Update probability
-		for ( unsigned d = 0; d++ < degrees[t]; ++neighbor )
-			pi_new[t] += pi_old[ *neighbor ] / degrees[ *neighbor ];
+		for ( unsigned d = 0; d++ < degrees[t]; ++neighbor, ++weight )
+			N::accumulate( pi, pi_old[ *neighbor ], *weight );
+
+		// Hash the support
+		if ( pi != N::template zero<T>() ) 
+		{ 
+			support ^= support_keys[t]; 
+			live |= 1u << colors[t]; 
+			if ( Split ) part_live[ parts[t] ] = 1; 
+		}
 
 		// Select tree with max probability for the next shot
-		if ( pi_new[t] > pi_max )
+		if ( (pi_new[t] = pi) > pi_max )
 		{ 
 			next_shot = t; 
-			pi_max    = pi_new[t]; 
+			pi_max    = pi; 
 		}
 	}
 
-	// If max has become too small, scale tables
-	if ( pi_max <= CHUCK_EPSILON )
+	return live;
+}
+
+
+
+/**
+ * [BasicJonathan::update_parts Skip the parts which have lost all their probability.]
+ * A part is cleared when the last shot left it empty; its entries of the other table
+ * still have to be zeroed at the next shot, after which it is not visited anymore.
+ */
+template <class T, class N>
+void BasicJonathan<T,N>::update_parts()
+{
+	for ( unsigned c = 0; c < n_parts; ++c )
 	{
-		array_a /= CHUCK_EPSILON;
-		array_b /= CHUCK_EPSILON;
+		if ( part_state[c] == PART_CLEARED ) part_state[c] = PART_ZERO;
+		else if ( part_state[c] == PART_LIVE && !part_live[c] ) part_state[c] = PART_CLEARED;
+
+		part_live[c] = 0;
 	}
+}
 
-	// Return current shot
-	return (int) tree;
+
+
+/**
+ * [BasicJonathan::shoot_batch Shoot up to k times, without virtual calls.]
+ * @param  shots [Output trees.]
+ * @param  k     [Number of shots.]
+ * @return       [Number of valid shots (less than k if Chuck gave up).]
+ */
+template <class T, class N>
+unsigned BasicJonathan<T,N>::shoot_batch( int *shots, const unsigned& k )
+{
+	return shoot_loop( *this, shots, k );
 }
 
 
 
+/**
+ * Explicit instantiations for the supported precisions and policies.
+ */
+template class BasicJonathan< float,       ThresholdRescaling >;
+template class BasicJonathan< double,      ThresholdRescaling >;
+template class BasicJonathan< long double, ThresholdRescaling >;
+
+template class BasicJonathan< float,       ShotRenormalization >;
+template class BasicJonathan< double,      ShotRenormalization >;
+template class BasicJonathan< long double, ShotRenormalization >;
+
+template class BasicJonathan< float,       ExponentTracking >;
+template class BasicJonathan< double,      ExponentTracking >;
+template class BasicJonathan< long double, ExponentTracking >;
+
+template class BasicJonathan< float,       LogDomain >;
+template class BasicJonathan< double,      LogDomain >;
+template class BasicJonathan< long double, LogDomain >;
+
+
+
 	/********************     **********     ********************/
 	/********************     **********     ********************/
 
@@ -163,6 +540,21 @@ void Angelo::clear()
 
 
 
+/**
+ * [Angelo::clone Copy settings and plan. The clone is ready for a new hunt.]
+ * @return [New hunter owned by the caller.]
+ */
+Angelo* Angelo::clone() const
+{
+	Angelo *chuck = new Angelo(*this);
+
+	// Iterator must be reset
+	chuck->restart();
+	return chuck;
+}
+
+
+
 /**
  * [Angelo::set_forest Set member data from current forest.]
  * @param  forest [A freshly generated forest.]
@@ -170,36 +562,114 @@ void Angelo::clear()
  */
 bool Angelo::set_forest( const Forest& forest )
 {
-	// Get forest information
-	Forest::agl_pair_type   cfg;
-	Forest::agl_vector_type cx;
+	// A connected forest is planned directly
+	const unsigned n_parts = forest.get_n_components();
+	if ( n_parts <= 1 ) { plan(forest); restart(); return true; }
+
+	// Otherwise, plan each part and play the plans in order
+	full_plan.clear();
+	for ( unsigned c = 0; c < n_parts; ++c )
+	{
+		forest.extract_component( c, part, part_trees );
+		plan(part);
+
+		// Bob may be in a part that cannot be cleared
+		if ( impossible ) break;
+
+		// Map back to the trees of the forest
+		for ( auto it = shot_sequence.crbegin(); it != shot_sequence.crend(); ++it ) 
+			full_plan.push_back( part_trees[*it] );
+	}
+
+	shot_sequence.assign( full_plan.rbegin(), full_plan.rend() );
+
+	// Restart iterator
+	restart();
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [Angelo::reserve Reserve the search tables of the largest parts that can be planned, and
+ * the plans of forests with up to n_trees trees.]
+ * A single hunter can only clear the parts which are lobsters, in at most 4n shots (see 
+ * Sweeper), so this bounds the plans; the budget of shots is not needed.
+ * @param n_trees [Max number of trees.]
+ */
+void Angelo::reserve( const unsigned& n_trees, const unsigned& )
+{
+	const unsigned n = n_trees, n_part = std::min<unsigned>( n, ANGELO_MAXTREES );
+
+	// Edges of the forest, and tables indexed by the subsets of a part
+	cx.reserve( n ? n*(n-1) >> 1 : 0 );
+	if ( parent_set.size() < (1u << n_part) ) 
+	{
+		parent_set.resize( 1 << n_part, -1 );
+		target_tree.resize( 1 << n_part );
+	}
+	unexplored.reserve( 1 << n_part );
+
+	// Parts and plans
+	part.reserve(n); part_trees.reserve(n);
+	form.reserve(n_part);
+
+	shot_sequence.reserve( 4*n ); full_plan.reserve( 4*n ); cached_plan.reserve( 4*n );
+}
+
 
+
+/**
+ * [Angelo::plan Compute the reversed plan of a connected forest in shot_sequence.]
+ * @param forest [A connected forest.]
+ */
+void Angelo::plan( const Forest& forest )
+{
+	// Get forest information
+	Forest::agl_pair_type cfg;
 	forest.acm_export( cfg, cx );
 
 	// Remember the number of trees
 	n_nodes = cfg.first;
 
+	// Too many trees to explore the subsets
+	if ( n_nodes > ANGELO_MAXTREES ) { shot_sequence.clear(); impossible = true; return; }
+
 	// Reset adjacency
-	memset( adjacency, 0, 22*sizeof(int) );
+	memset( adjacency, 0, sizeof(adjacency) );
 	for ( auto it = cx.cbegin(); it != cx.cend(); ++it )
 	{
 		adjacency[ it->first ]  |= 1 << it->second;
 		adjacency[ it->second ] |= 1 << it->first;
 	}
 
-	// Compute results
-	impossible = !bfs();
+	// With a cache, plans are computed on the canonical relabeling of the forest and mapped
+	// back, so that they only depend on the isomorphism class, whether they are found or not
+	if ( cache && form.compute(forest) )
+	{
+		if ( cache->find( form, cached_plan, impossible ) )
+			shot_sequence.assign( cached_plan.rbegin(), cached_plan.rend() );
+		else
+		{
+			const CanonicalForm::key_type& rows = form.key();
+			const CanonicalForm::labeling_type& inverse = form.inverse();
 
-	// Restart iterator
-	restart();
+			for ( int t = 0; t < n_nodes; ++t ) adjacency[t] = (int) rows[t];
+			impossible = !bfs();
+
+			for ( auto it = shot_sequence.begin(); it != shot_sequence.end(); ++it ) *it = inverse[*it];
+			cached_plan.assign( shot_sequence.rbegin(), shot_sequence.rend() );
+			cache->insert( form, cached_plan, impossible );
+		}
+	}
+	else impossible = !bfs();
 
 	// // Print shot sequence
 	// printf("Shot sequence(%u) = [", shot_sequence.size());
 	// for ( auto it = shot_sequence.begin(); it != shot_sequence.end(); ) printf(" %d ", *it++);
 	// if (impossible) printf("] [IMP] \n"); else printf("]\n");
-
-	// Report success
-	return true;
 }
 
 
@@ -216,78 +686,118 @@ void Angelo::restart()
 
 /**
  * [Angelo::bfs Setup shooting strategy from the forest adjacency.]
+ * The search is compiled for each number of trees up to ANGELO_MAXTREES, so that the 
+ * loops over the trees have a constant trip count.
  * @return [Whether the planning was successful or the algorithm failed.]
  */
 bool Angelo::bfs()
 {
+	#define ANGELO_CASE(N) case N: return bfs_kernel<N>();
+
+	switch ( n_nodes )
+	{
+		ANGELO_CASE(0)  ANGELO_CASE(1)  ANGELO_CASE(2)  ANGELO_CASE(3)  ANGELO_CASE(4)  
+		ANGELO_CASE(5)  ANGELO_CASE(6)  ANGELO_CASE(7)  ANGELO_CASE(8)  ANGELO_CASE(9)  
+		ANGELO_CASE(10) ANGELO_CASE(11) ANGELO_CASE(12) ANGELO_CASE(13) ANGELO_CASE(14) 
+		ANGELO_CASE(15) ANGELO_CASE(16) ANGELO_CASE(17) ANGELO_CASE(18) ANGELO_CASE(19) 
+		ANGELO_CASE(20) ANGELO_CASE(21)
+		default: shot_sequence.clear(); return false;
+	}
+
+	#undef ANGELO_CASE
+}
+
+
+
+/**
+ * [Angelo::bfs_kernel Breadth-first search on the subsets of N trees.]
+ * The queue is a vector read from its head, since each subset is queued at most once; 
+ * the tables grow to the largest part planned so far, and the entries of the subsets 
+ * explored are reset at the end, so that the search does not allocate once warm.
+ * @return [Whether the planning was successful or the algorithm failed.]
+ */
+template <int N>
+bool Angelo::bfs_kernel()
+{
+	static_assert( N <= ANGELO_MAXTREES, "Too many trees for Angelo's search." );
+
+	// Begin from the first node (explore all others)
+	const int all_nodes_but_first = (1 << N) - 1;
 
 	// Local variables
-	int exploration_set, complement_adjacency;
+	int exploration_set = all_nodes_but_first, complement_adjacency;
 
-	// Allocate storage
-	std::bitset<MAXSIZE> explored;
-	std::vector<int> target_tree( MAXSIZE ), parent_set( MAXSIZE );
+	// Grow the tables if needed
+	if ( parent_set.size() < (1u << N) ) 
+	{
+		parent_set.resize( 1 << N, -1 );
+		target_tree.resize( 1 << N );
+	}
+
+	// Local copy of the adjacency
+	std::array<int, N> adj;
+	std::copy( adjacency, adjacency + N, adj.begin() );
 
 	// Reset shot sequence
 	shot_sequence.clear();
 
-	// Begin from the first node (explore all others)
-	const int all_nodes_but_first = (1 << n_nodes) - 1;
-
 	// Initialize unexplored queue
-	std::list<int> unexplored; 
+	unexplored.clear();
 	unexplored.push_back(all_nodes_but_first);
+	uint64_t n_states = 0, peak_queue = 1;
 
 	// Explore nodes
-	while( !unexplored.empty() )
+	for ( unsigned head = 0; head < unexplored.size(); )
 	{
 
 		// Pull new exploration set from queue
-		if( (exploration_set = unexplored.front()) == 0 ) break;
-		unexplored.pop_front();
+		if( (exploration_set = unexplored[head]) == 0 ) break;
+		++head; ++n_states;
 
 		// Explore each node of the set
-		for ( int i = 0, current_node = 1; i < n_nodes; ++i, current_node = current_node << 1 ) 
-			if( exploration_set & current_node )
+		for ( int i = 0; i < N; ++i ) if( exploration_set & (1 << i) )
 		{
 
 			// All nodes of the set, except the current one
-			const int node_complement = exploration_set ^ current_node;
+			const int node_complement = exploration_set ^ (1 << i);
 
-			// Create a new set with the adjacency of the complement
+			// Create a new set with the adjacency of the complement (the masks avoid 
+			// branches, so that this loop is fully unrolled)
 			complement_adjacency = 0;
-
-			// Iterate on each node of the complement, adding its adjacency
-			for ( int j = 0, other_node = 1; j < n_nodes; ++j, other_node = other_node << 1 ) 
-				if( node_complement & other_node) 
-					complement_adjacency |= adjacency[j];
+			for ( int j = 0; j < N; ++j ) 
+				complement_adjacency |= adj[j] & -( (node_complement >> j) & 1 );
 
 			// Remember the current node, the current complement adjacency, and 
 			// the link between this new set and the current exploration set.
-			if( !explored[complement_adjacency] )
+			if( parent_set[complement_adjacency] < 0 )
 			{
-				explored[complement_adjacency]    = true;
 				parent_set[complement_adjacency]  = exploration_set;
 				target_tree[complement_adjacency] = i;
 
 				unexplored.push_back(complement_adjacency);
+				peak_queue = std::max<uint64_t>( peak_queue, unexplored.size() - head );
 			}
 		}
 
 	}
 
-	// Impossible
-	if( exploration_set != 0 ) return false;
+	// Report the size of the search
+	Counters::add( COUNTER_BFS_STATES, n_states );
+	Counters::peak( COUNTER_BFS_PEAK_QUEUE, peak_queue );
 
 	// Rollback through the parent sets, and stack the corresponding target trees
-	while( exploration_set != all_nodes_but_first )
+	const bool success = exploration_set == 0;
+	while( success && exploration_set != all_nodes_but_first )
 	{
 		shot_sequence.push_back(target_tree[exploration_set]);
 		exploration_set = parent_set[exploration_set];
 	}
 
+	// Mark the queued subsets as unexplored for the next search
+	for ( auto it = unexplored.cbegin(); it != unexplored.cend(); ++it ) parent_set[*it] = -1;
+
 	// Report success
-	return true;
+	return success;
 }
 
 
@@ -296,3 +806,200 @@ bool Angelo::bfs()
 	/********************     **********     ********************/
 
 
+
+/**
+ * [Sweeper::clear Clear all member data.]
+ */
+void Sweeper::clear()
+{
+	plan.clear(); 
+	impossible = true;
+
+	// Reset iterator
+	current_shot = plan.begin();
+}
+
+
+
+/**
+ * [Sweeper::clone Copy the plan. The clone is ready for a new hunt.]
+ * @return [New hunter owned by the caller.]
+ */
+Sweeper* Sweeper::clone() const
+{
+	Sweeper *chuck = new Sweeper(*this);
+
+	// Iterator must be reset
+	chuck->restart();
+	return chuck;
+}
+
+
+
+/**
+ * [Sweeper::restart Reset shot sequence.]
+ */
+void Sweeper::restart()
+{
+	current_shot = plan.begin();
+}
+
+
+
+/**
+ * [Sweeper::reserve Reserve the plan and the tables of forests with up to n_trees trees.]
+ * @param n_trees [Max number of trees.]
+ */
+void Sweeper::reserve( const unsigned& n_trees, const unsigned& )
+{
+	const unsigned n = n_trees;
+
+	// At most 4n shots, see the class description
+	plan.reserve( 4*n );
+
+	inner_degrees.reserve(n); starts.reserve(n); spine.reserve(n);
+	rank.reserve(n); balance.reserve(n); on_spine.reserve(n);
+}
+
+
+
+/**
+ * [Sweeper::set_forest Check that each part is a lobster, and build the plan.]
+ * A part with n trees is a tree iff its degrees sum to 2(n-1). Its core (the inner trees 
+ * with at least two inner neighbors) is a path iff no tree of the core has more than two
+ * neighbors in the core; the core is empty when the part has at most two inner trees.
+ * @param  forest [A freshly generated forest.]
+ * @return        [Whether setting was successful or not.]
+ */
+bool Sweeper::set_forest( const Forest& forest )
+{
+	// Get forest information
+	const unsigned n = forest.size(), n_parts = forest.get_n_components();
+	const Forest::vector_type& neighbors  = forest.get_neighbors();
+	const Forest::vector_type& components = forest.get_components();
+	const Forest::array_type&  degrees    = forest.get_degrees();
+	const Forest::array_type&  strides    = forest.get_strides();
+
+	// Degrees among inner trees
+	inner_degrees.assign( n, 0 );
+	for ( unsigned t = 0; t < n; ++t ) if ( degrees[t] > 1 )
+	for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) 
+		inner_degrees[t] += degrees[ neighbors[e] ] > 1;
+
+	// Start each part from an end of its core, or from an inner tree, or from any tree
+	starts.assign( n_parts, n );
+	balance.assign( n_parts, 0 );
+	rank.assign( n_parts, 0 ); // 0: any tree, 1: inner, 2: end of the core
+
+	impossible = false;
+	for ( unsigned t = 0; t < n && !impossible; ++t )
+	{
+		const unsigned p = components[t];
+		balance[p] += 2 - (int) degrees[t];
+
+		unsigned r = degrees[t] > 1;
+		if ( inner_degrees[t] > 1 )
+		{
+			unsigned core_degree = 0;
+			for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) 
+				core_degree += inner_degrees[ neighbors[e] ] > 1;
+
+			if ( core_degree > 2 ) impossible = true;
+			r = core_degree < 2 ? 2 : 0;
+		}
+
+		if ( starts[p] == n || r > rank[p] ) { starts[p] = t; rank[p] = r; }
+	}
+
+	// Each part must be a tree
+	for ( unsigned p = 0; p < n_parts && !impossible; ++p ) impossible = balance[p] != 2;
+
+	// Sweep each part in turn
+	plan.clear();
+	if ( !impossible ) 
+	{
+		on_spine.assign( n, false );
+		for ( unsigned p = 0; p < n_parts; ++p ) sweep( forest, starts[p] );
+	}
+
+	// Restart iterator
+	restart();
+
+	// Report success
+	return true;
+}
+
+
+
+/**
+ * [Sweeper::sweep Append the forward and backward sweeps of a lobster to the plan.]
+ * The spine is the core, extended at each end by an inner tree out of the core (the 
+ * longest path among inner trees); every other inner tree is a branch of the spine.
+ * @param forest [Current forest.]
+ * @param start  [End of the core of the part, or an inner tree if the core is empty, 
+ *               or any tree if there is no inner tree.]
+ */
+void Sweeper::sweep( const Forest& forest, const unsigned& start )
+{
+	const Forest::vector_type& neighbors = forest.get_neighbors();
+	const Forest::array_type&  strides   = forest.get_strides();
+
+	// Inner trees out of the core, and trees of the core
+	auto branch = [&]( const unsigned& t ){ return inner_degrees[t] == 1 && !on_spine[t]; };
+	auto core   = [&]( const unsigned& t ){ return inner_degrees[t] > 1; };
+
+	spine.clear();
+	spine.push_back(start); on_spine[start] = true;
+
+	if ( core(start) )
+	{
+		// Walk along the core
+		for ( bool more = true; more; )
+		{
+			more = false;
+			const unsigned t = spine.back();
+
+			for ( unsigned e = strides[t]; e < strides[t+1] && !more; ++e )
+				if ( core(neighbors[e]) && !on_spine[neighbors[e]] ) 
+				{
+					spine.push_back( neighbors[e] ); on_spine[ neighbors[e] ] = true; more = true;
+				}
+		}
+
+		// Extend both ends with a branch
+		for ( unsigned end = 0; end < 2; ++end )
+		{
+			const unsigned t = end ? spine.back() : spine.front();
+
+			for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) if ( branch(neighbors[e]) )
+			{
+				on_spine[ neighbors[e] ] = true;
+				if ( end ) spine.push_back( neighbors[e] ); else spine.insert( spine.begin(), neighbors[e] );
+				break;
+			}
+		}
+	}
+	else if ( inner_degrees[start] == 1 )
+	{
+		// Two inner trees
+		for ( unsigned e = strides[start]; e < strides[start+1]; ++e ) 
+			if ( forest.get_degrees()[ neighbors[e] ] > 1 ) { spine.push_back( neighbors[e] ); on_spine[ neighbors[e] ] = true; }
+	}
+
+	// Forward then backward, with a detour to each branch
+	for ( unsigned pass = 0; pass < 2; ++pass )
+	for ( unsigned i = 0; i < spine.size(); ++i )
+	{
+		const unsigned t = pass ? spine[ spine.size()-1-i ] : spine[i];
+		plan.push_back(t);
+
+		for ( unsigned e = strides[t]; e < strides[t+1]; ++e ) if ( branch(neighbors[e]) )
+		{
+			plan.push_back( neighbors[e] );
+			plan.push_back(t);
+		}
+	}
+
+	// Reset the flags for the next part
+	for ( auto it = spine.begin(); it != spine.end(); ++it ) on_spine[*it] = false;
+}
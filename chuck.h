@@ -12,14 +12,18 @@
 
 #include <cstring>
 #include <vector>
-#include <bitset>
-#include <list>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 
 #include <valarray>
 #include "forest.h"
+#include "canonical.h"
 
 #define CHUCK_EPSILON 1e-10
-#define MAXSIZE (1<<21)
+#define ANGELO_MAXTREES 21
+#define CHUCK_PATIENCE 8
 
 
 
@@ -34,6 +38,14 @@
  */
 struct ChuckInterface
 {
+	virtual ~ChuckInterface() {}
+
+	/**
+	 * This should return a new hunter with the same settings, owned by the caller. 
+	 * Hunters are stateful, so each thread of the benchmark works with its own clones.
+	 */
+	virtual ChuckInterface* clone() const =0;
+
 	/**
 	 * This should initialize Chuck by providing information about the forest
 	 * (number of trees, adjacency). The Forest object implements a method
@@ -42,6 +54,13 @@ struct ChuckInterface
 	 */
 	virtual bool set_forest( const Forest& forest ) =0;
 
+	/**
+	 * This can reserve the storage of forests with up to n_trees trees, and hunts of
+	 * up to n_shots shots (0 if there is no budget), so that set_forest and the hunts
+	 * don't allocate. The default does nothing.
+	 */
+	virtual void reserve( const unsigned& /* n_trees */, const unsigned& /* n_shots */ ) {}
+
 	/**
 	 * This method is called before the beginning of each hunt.
 	 * Once Chuck has been initialized using set_forest() above,
@@ -61,64 +80,234 @@ struct ChuckInterface
 	 * monkey and will be counted as a failure in the results statistics.
 	 */
 	virtual int shoot() =0;
+
+	/**
+	 * Shoot up to k times in a row, writing the trees in shots. This returns the number
+	 * of valid shots, which is less than k only if Chuck gave up. The default calls
+	 * shoot() k times; hunters override it with a loop on their own (non-virtual) shoot, 
+	 * see shoot_loop below.
+	 */
+	virtual unsigned shoot_batch( int *shots, const unsigned& k )
+	{
+		unsigned n = 0;
+		while ( n < k && (shots[n] = shoot()) >= 0 ) ++n;
+		return n;
+	}
 };
 
 
 
+/**
+ * Batched shots of a known hunter type: the calls to Hunter::shoot are qualified, so
+ * they are bound statically (and inlined when the definition is visible).
+ */
+template <class Hunter>
+inline unsigned shoot_loop( Hunter& hunter, int *shots, const unsigned& k )
+{
+	unsigned n = 0;
+	while ( n < k && (shots[n] = hunter.Hunter::shoot()) >= 0 ) ++n;
+	return n;
+}
+
+
+
 	/********************     **********     ********************/
 	/********************     **********     ********************/
 
 
 
+/**
+ * Normalization policies for John's probability tables.
+ *
+ * The tables decay geometrically as the monkey escapes the shots, and have to be
+ * kept within the range of the value type T. Each policy defines the representation
+ * of the probabilities (zero, uniform value, transition weights and accumulation), 
+ * and how the tables are rescaled after each shot. The policy never changes the 
+ * ordering of the probabilities, hence (up to rounding) the shot sequence.
+ */
+
+// Divide by CHUCK_EPSILON whenever the max probability falls below it (original behaviour).
+struct ThresholdRescaling
+{
+	template <class T> static inline T zero() { return T(0); }
+	template <class T> static inline T uniform( const unsigned& n ) { return T(1)/n; }
+	template <class T> static inline T weight( const unsigned& degree ) { return T(1)/degree; }
+	template <class T> static inline T weight( const double& p ) { return T(p); }
+	template <class T> static inline void accumulate( T& acc, const T& p, const T& w ) { acc += p*w; }
+
+	inline void reset() {}
+	template <class T> bool normalize( T *pi, const unsigned& n, const T& pi_max );
+};
+
+// Divide by the max probability after every shot.
+struct ShotRenormalization
+{
+	template <class T> static inline T zero() { return T(0); }
+	template <class T> static inline T uniform( const unsigned& n ) { return T(1)/n; }
+	template <class T> static inline T weight( const unsigned& degree ) { return T(1)/degree; }
+	template <class T> static inline T weight( const double& p ) { return T(p); }
+	template <class T> static inline void accumulate( T& acc, const T& p, const T& w ) { acc += p*w; }
+
+	inline void reset() {}
+	template <class T> bool normalize( T *pi, const unsigned& n, const T& pi_max );
+};
+
+// Rescale by an exact power of two when the max gets small, and keep track of the exponent.
+struct ExponentTracking
+{
+	template <class T> static inline T zero() { return T(0); }
+	template <class T> static inline T uniform( const unsigned& n ) { return T(1)/n; }
+	template <class T> static inline T weight( const unsigned& degree ) { return T(1)/degree; }
+	template <class T> static inline T weight( const double& p ) { return T(p); }
+	template <class T> static inline void accumulate( T& acc, const T& p, const T& w ) { acc += p*w; }
+
+	inline void reset() { exponent = 0; }
+	template <class T> bool normalize( T *pi, const unsigned& n, const T& pi_max );
+
+	// Probabilities are pi * 2^exponent
+	long exponent;
+};
+
+// Store log-probabilities, and subtract the max when it gets too small.
+struct LogDomain
+{
+	template <class T> static inline T zero() { return -std::numeric_limits<T>::infinity(); }
+	template <class T> static inline T uniform( const unsigned& n ) { return -std::log( T(n) ); }
+	template <class T> static inline T weight( const unsigned& degree ) { return -std::log( T(degree) ); }
+	template <class T> static inline T weight( const double& p ) { return T( std::log(p) ); }
+	template <class T> static inline void accumulate( T& acc, const T& p, const T& w ) 
+	{ 
+		T x = p + w;
+		if ( x > acc ) std::swap(acc,x);
+		if ( x != zero<T>() ) acc += std::log1p( std::exp(x - acc) ); 
+	}
+
+	inline void reset() {}
+	template <class T> bool normalize( T *pi, const unsigned& n, const T& pi_max );
+};
+
+
+
 /**
  * John's strategy for Chuck. See notes for details.
+ * The value type T of the probability tables and the Normalization policy are template 
+ * parameters; Jonathan below is the reference (double precision, threshold rescaling).
+ *
+ * On bipartite forests (eg. trees), Bob changes class at every jump. As soon as one class
+ * has no probability left, the other class is the only one that can hold Bob at each
+ * step, and only its rows are propagated, from a copy of the adjacency sorted by class.
+ * Likewise, the connected parts of the forest which cannot hold Bob anymore are skipped.
  */
-class Jonathan : public ChuckInterface
+template <class T, class Normalization = ThresholdRescaling>
+class BasicJonathan : public ChuckInterface
 {
 public:
 
+	typedef T value_type;
+	typedef Normalization normalization_type;
+
+	// Ctor
+	BasicJonathan() 
+		: pi_new(nullptr), pi_old(nullptr), patience(CHUCK_PATIENCE), 
+		stuck(false), bipartite(false), stale(false), live_class(-1), 
+		n_parts(0), next_shot(0), n_nodes(0), n_edges(0) {}
+
+	// Copy settings and forest
+	BasicJonathan* clone() const;
+
+	// Give up when a state (support, next shot) is visited more than p*n times (0 to disable)
+	inline void set_patience( const unsigned& p ) { patience = p; }
+
 	// Clear all member data
 	void clear();
 
 	// Set from current forest
 	bool set_forest( const Forest& forest );
 
+	// Reserve the tables of the forests and the states of the hunts
+	void reserve( const unsigned& n_trees, const unsigned& n_shots );
+
 	// Reset probability tables to uniform distribution
 	void restart();
 
 	// Shoot
 	int shoot();
+	unsigned shoot_batch( int *shots, const unsigned& k );
 
 private:
 
 	// Swap pointers to arrays
 	void swap_pointers();
 
-	// Members
+	// Propagate to all the trees, compiled with and without tracking of the parts
+	template <bool Split> 
+	unsigned full_sweep( T& pi_max, uint64_t& support );
+
+	// Track the parts which can still hold Bob
+	void update_parts();
+
+	// Members (vectors keep their storage from one forest to the next)
 	// 
-	double *pi_new, *pi_old;
-	std::valarray<unsigned> degrees, neighbors;
-	std::valarray<double> array_a, array_b;
+	T *pi_new, *pi_old;
+	std::vector<unsigned> degrees, neighbors;
+	std::vector<T> weights, array_a, array_b;
+	Normalization normalization;
+
+	// Stagnation detection
+	std::vector<uint64_t> support_keys;
+	StateCounter visited;
+	unsigned patience; bool stuck;
+
+	// Bipartite forests: class of each tree, and rows and adjacency sorted by class
+	std::vector<unsigned> colors, class_rows, class_degrees, class_neighbors;
+	std::vector<T> class_weights;
+	unsigned class_start[3], edge_start[3];
+	bool bipartite, stale; int live_class;
+
+	// Connected part of each tree, and state of each part (see PartState)
+	enum PartState { PART_LIVE, PART_CLEARED, PART_ZERO };
+	std::vector<unsigned> parts;
+	std::vector<unsigned char> part_state, part_live;
+	unsigned n_parts;
 
 	unsigned next_shot, n_nodes, n_edges;
 
 };
 
+typedef BasicJonathan<double> Jonathan;
+
 
 
 /**
  * Angelo's strategy for Chuck.
+ * Bob never leaves the connected part of the forest where he starts, so each part is 
+ * planned on its own (at most ANGELO_MAXTREES trees each), and the plans are played one 
+ * after the other. Plans of parts can be shared between isomorphic parts through a PlanCache;
+ * they are then computed on the canonical labeling of the part, and do not depend on the
+ * contents of the cache.
  */
 class Angelo : public ChuckInterface
 {
 public:
 
+	// Ctor
+	Angelo() : cache(nullptr) {}
+
+	// Copy settings (the cache is shared) and plan
+	Angelo* clone() const;
+
 	// Clear member data
 	void clear();
 
+	// Look for plans in a cache before planning (nullptr to disable)
+	inline void set_cache( PlanCache *c ) { cache = c; }
+
 	// Set hunter from forest information
 	bool set_forest( const Forest& forest );
 
+	// Reserve the search tables and the plans
+	void reserve( const unsigned& n_trees, const unsigned& n_shots );
+
 	// Reset hunter for new hunt
 	void restart();
 
@@ -128,19 +317,122 @@ public:
 		return ( impossible || current_shot == shot_sequence.rend() ) ? -1 : *current_shot++;
 	}
 
+	// The plan is precomputed, so batches are copied from it
+	inline unsigned shoot_batch( int *shots, const unsigned& k )
+	{
+		if ( impossible ) return 0;
+
+		const unsigned n = std::min<std::ptrdiff_t>( k, shot_sequence.rend() - current_shot );
+		std::copy( current_shot, current_shot + n, shots ); current_shot += n;
+		return n;
+	}
+
 private:
 
-	// Angelo's code
+	// Plan a connected forest
+	void plan( const Forest& forest );
+
+	// Angelo's code, dispatched to the kernel compiled for n_nodes
 	bool bfs();
 
+	template <int N> 
+	bool bfs_kernel();
+
 	// Members
 	//
-	int n_nodes, adjacency[22]; bool impossible;
-	
+	int n_nodes, adjacency[ANGELO_MAXTREES+1]; bool impossible;
+
+	// Edges of the part, and tables of the search indexed by subsets of trees, which keep
+	// their storage from one plan to the next (parent_set is -1 for unexplored subsets)
+	Forest::agl_vector_type cx;
+	std::vector<int> target_tree, parent_set, unexplored;
+
+	// Current connected part, and plan of the whole forest
+	Forest part;
+	Forest::vector_type part_trees;
+	std::vector<int> full_plan;
 
 	std::vector<int> shot_sequence;
 	std::vector<int>::const_reverse_iterator current_shot;
 
+	// Cache of plans
+	PlanCache *cache;
+	PlanCache::plan_type cached_plan;
+	CanonicalForm form;
+
+};
+
+
+
+/**
+ * Constructive strategy for Chuck, in linear time and without any search.
+ * A single hunter wins on a forest iff each connected part is a lobster, ie. a tree which
+ * becomes a path once its leaves are removed twice (equivalently, which does not contain 
+ * the spider with three legs of length 3):
+ *
+ * Britnell, J.R. and Wildon, M. "Finding a princess in a palace: A pursuit-evasion problem"
+ * The Electronic Journal of Combinatorics 20, vol. 1, P25, 2013
+ *
+ * Each part is swept along the longest path of its inner trees (the spine), with a detour
+ * (branch, back to spine) to each inner tree off the spine, which catches Bob if he is in 
+ * phase with the shots. The sweep is then played backwards for the other phase, hence at 
+ * most 2(k + 2b) shots for a part with k trees on the spine and b branches. Other forests 
+ * are reported impossible.
+ */
+class Sweeper : public ChuckInterface
+{
+public:
+
+	// Ctor
+	Sweeper() : impossible(true) {}
+
+	// Copy plan
+	Sweeper* clone() const;
+
+	// Clear member data
+	void clear();
+
+	// Build the plan from the forest
+	bool set_forest( const Forest& forest );
+
+	// Reserve the plan and the tables of the parts
+	void reserve( const unsigned& n_trees, const unsigned& n_shots );
+
+	// Reset hunter for new hunt
+	void restart();
+
+	// Shoot
+	inline int shoot()
+	{
+		return ( impossible || current_shot == plan.end() ) ? -1 : *current_shot++;
+	}
+
+	inline unsigned shoot_batch( int *shots, const unsigned& k )
+	{
+		if ( impossible ) return 0;
+
+		const unsigned n = std::min<std::ptrdiff_t>( k, plan.end() - current_shot );
+		std::copy( current_shot, current_shot + n, shots ); current_shot += n;
+		return n;
+	}
+
+private:
+
+	// Append the sweeps of a lobster to the plan, from an end of its spine
+	void sweep( const Forest& forest, const unsigned& start );
+
+	// Members
+	// 
+	std::vector<int> plan;
+	std::vector<int>::const_iterator current_shot;
+	bool impossible;
+
+	// Degree of each tree among inner trees (non-leaves), first tree, its rank and balance of 
+	// each part, and spine of the current part
+	Forest::vector_type inner_degrees, starts, spine;
+	std::vector<unsigned char> rank;
+	std::vector<int> balance;
+	std::vector<bool> on_spine;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "counters.h"
+
+//=============================================
+// @filename     counters.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [CounterValues::clear Reset all values.]
+ */
+void CounterValues::clear()
+{
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) value[c] = 0;
+}
+
+
+
+/**
+ * [CounterValues::merge Add the values of other sections (max for gauges).]
+ * @param other [The other values.]
+ */
+void CounterValues::merge( const CounterValues& other )
+{
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) 
+		if ( c == COUNTER_BFS_PEAK_QUEUE ) { if ( other.value[c] > value[c] ) value[c] = other.value[c]; }
+		else value[c] += other.value[c];
+}
+
+
+
+/**
+ * [CounterValues::any Whether any counter is non-zero.]
+ */
+bool CounterValues::any() const
+{
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) if ( value[c] ) return true;
+	return false;
+}
+
+
+
+/**
+ * [CounterValues::print Display the values on stdout.]
+ * @param ops [Number of operations (eg. forests), to average the sums.]
+ * @param op  [Name of an operation.]
+ */
+void CounterValues::print( const uint64_t& ops, const char *op ) const
+{
+	static const char *names[COUNTER_ALLOC_GENERATION] = { "rejected sequences", "forest restarts", 
+		"SIS failures", "bfs states", "bfs peak queue", "rescales" };
+
+	bool found = false;
+	for ( unsigned c = 0; c < COUNTER_ALLOC_GENERATION; ++c ) found = found || value[c];
+	if ( !found ) return;
+
+	printf("\t- Counters (total, per %s):", op);
+	for ( unsigned c = 0; c < COUNTER_ALLOC_GENERATION; ++c ) if ( value[c] )
+	{
+		if ( c == COUNTER_BFS_PEAK_QUEUE ) printf(" %s=%llu (max)", names[c], (unsigned long long) value[c]);
+		else printf(" %s=%llu (%.2f)", names[c], (unsigned long long) value[c], ops ? double(value[c]) / ops : 0.0);
+	}
+	printf("\n");
+}
+
+
+
+/**
+ * [CounterValues::print_allocations Display the heap allocations of each phase on stdout, 
+ * including the phases which did not allocate.]
+ * @param ops [Number of operations (eg. forests), to average the sums.]
+ * @param op  [Name of an operation.]
+ */
+void CounterValues::print_allocations( const uint64_t& ops, const char *op ) const
+{
+	static const char *phases[3] = { "generation", "set_forest", "hunts" };
+	const double scale = ops ? 1.0 / ops : 0.0;
+
+	printf("\t- Allocations (per %s, bytes):", op);
+	for ( unsigned p = 0; p < 3; ++p )
+		printf(" %s=%.2f (%.1f)", phases[p], value[ COUNTER_ALLOC_GENERATION + 2*p ] * scale, 
+			value[ COUNTER_BYTES_GENERATION + 2*p ] * scale);
+	printf(", %llu of %llu %ss allocated\n", (unsigned long long) value[COUNTER_ALLOC_INSTANCES], 
+		(unsigned long long) ops, op);
+}
+
+
+
+/**
+ * [CounterValues::save Write each value.]
+ * @param f [Output file.]
+ */
+void CounterValues::save( FILE *f ) const
+{
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) 
+		fprintf( f, c ? " %llu" : "%llu", (unsigned long long) value[c] );
+}
+
+
+
+/**
+ * [CounterValues::load Read values written by save.]
+ * @param  f [Input file.]
+ * @return   [False if the input is invalid.]
+ */
+bool CounterValues::load( FILE *f )
+{
+	unsigned long long x;
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c )
+	{
+		if ( fscanf( f, "%llu", &x ) != 1 ) return false;
+		value[c] = x;
+	}
+
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [Counters::clear Reset the shard of the calling thread.]
+ */
+void Counters::clear()
+{
+	uint64_t *values = shard();
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) values[c] = 0;
+}
+
+
+
+/**
+ * [Counters::collect Move the shard of the calling thread into a set of values.]
+ * @param values [Values to merge the shard into.]
+ */
+void Counters::collect( CounterValues& values )
+{
+	CounterValues local;
+	uint64_t *values_shard = shard();
+
+	for ( unsigned c = 0; c < COUNTER_N_COUNTERS; ++c ) local.value[c] = values_shard[c];
+	values.merge( local );
+	clear();
+}
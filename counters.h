@@ -0,0 +1,98 @@
+#ifndef __COUNTERS__
+#define __COUNTERS__
+
+//=============================================
+// @filename     counters.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdio>
+#include <cstdint>
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Software counters of the slow paths. Most are sums; COUNTER_BFS_PEAK_QUEUE is a gauge,
+ * which keeps the largest value seen. The heap allocations of each phase of an instance
+ * are only counted when the allocation tracker is built in (see Allocations).
+ */
+enum CounterId 
+{ 
+	COUNTER_SEQUENCE_REJECTIONS, // degree sequences which were not graphic
+	COUNTER_FOREST_RESTARTS,     // CUR graphs thrown away because of an isolated tree
+	COUNTER_SIS_FAILURES,        // loss of precision in the CUR edge selection
+	COUNTER_BFS_STATES,          // support sets dequeued by Angelo::bfs
+	COUNTER_BFS_PEAK_QUEUE,      // largest queue of Angelo::bfs
+	COUNTER_RESCALES,            // rescalings of Jonathan's tables
+	COUNTER_ALLOC_GENERATION,    // heap allocations while generating the forest
+	COUNTER_BYTES_GENERATION,    // bytes allocated while generating the forest
+	COUNTER_ALLOC_SET_FOREST,    // heap allocations in the set_forest of the hunters
+	COUNTER_BYTES_SET_FOREST,    // bytes allocated in the set_forest of the hunters
+	COUNTER_ALLOC_HUNT,          // heap allocations during the hunts
+	COUNTER_BYTES_HUNT,          // bytes allocated during the hunts
+	COUNTER_ALLOC_INSTANCES,     // instances which allocated in any of these phases
+	COUNTER_N_COUNTERS
+};
+
+
+
+/**
+ * Values of all counters, eg. for one instance or one size of a sweep.
+ */
+struct CounterValues
+{
+	uint64_t value[COUNTER_N_COUNTERS];
+
+	CounterValues() { clear(); }
+
+	void clear();
+	void merge( const CounterValues& other );
+
+	// Has anything been counted?
+	bool any() const;
+
+	// Display totals, and averages over a number of operations
+	void print( const uint64_t& ops, const char *op ) const;
+	void print_allocations( const uint64_t& ops, const char *op ) const;
+
+	// Text serialization (on a single line, without newline)
+	void save( FILE *f ) const;
+	bool load( FILE *f );
+};
+
+
+
+/**
+ * Registry of the counters, with one shard per thread, so that the hot paths increment 
+ * a thread-local value without any synchronization. The benchmark clears the shard of 
+ * the worker before each instance, and collects it afterwards.
+ */
+struct Counters
+{
+	// Shard of the calling thread (zero-initialized, without guard)
+	static inline uint64_t* shard()
+	{
+		static thread_local uint64_t values[COUNTER_N_COUNTERS];
+		return values;
+	}
+
+	static inline void add( const CounterId& c, const uint64_t& k = 1 ) { shard()[c] += k; }
+	static inline void peak( const CounterId& c, const uint64_t& v ) { if ( v > shard()[c] ) shard()[c] = v; }
+
+	// Reset the shard of the calling thread
+	static void clear();
+
+	// Merge the shard of the calling thread into values, and reset it
+	static void collect( CounterValues& values );
+};
+
+#endif
@@ -26,4 +26,91 @@ void SMCSIndexer::ind2sub( const unsigned& n, const unsigned& index, unsigned& i
 	const double x = n + 0.5;
 	j = static_cast<unsigned>( x - sqrt( x*x - (index<<1) ) );
 	i = index - ((j* ( (n<<1) - j-1 )) >> 1);
-}
\ No newline at end of file
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [StateCounter::clear Forget all keys, but keep the allocated memory.]
+ * Only the slots in use are reset, so that a large table is cheap to clear.
+ */
+void StateCounter::clear()
+{
+	for ( auto it = filled.cbegin(); it != filled.cend(); ++it ) { keys[*it] = 0; counts[*it] = 0; }
+	filled.clear();
+	n_keys = 0;
+}
+
+
+
+/**
+ * [StateCounter::reserve Grow the table so that n distinct keys fit without rehashing.]
+ * @param n [Number of distinct keys.]
+ */
+void StateCounter::reserve( const unsigned& n )
+{
+	// Keep load factor below 1/2
+	std::size_t capacity = keys.size() ? keys.size() : 64;
+	while ( capacity < (std::size_t) n << 1 ) capacity <<= 1;
+
+	if ( capacity > keys.size() ) rehash( capacity );
+}
+
+
+
+/**
+ * [StateCounter::increment Increment the count associated with a key.]
+ * @param  key [Any 64 bits key (0 is remapped).]
+ * @return     [The number of times this key was incremented since the last clear.]
+ */
+unsigned StateCounter::increment( uint64_t key )
+{
+	// Keep load factor below 1/2
+	if ( (n_keys+1) << 1 > keys.size() ) rehash( keys.size() ? keys.size() << 1 : 64 );
+
+	// Reserved key
+	if ( key == 0 ) key = 1;
+
+	// Linear probing
+	const std::size_t mask = keys.size() - 1;
+	std::size_t k = key & mask;
+
+	while ( keys[k] && keys[k] != key ) k = (k+1) & mask;
+	if ( !keys[k] ) { keys[k] = key; filled.push_back(k); ++n_keys; }
+
+	return ++counts[k];
+}
+
+
+
+/**
+ * [StateCounter::rehash Change the capacity of the table and reinsert existing keys.]
+ * @param capacity [New number of slots, a power of two (at least twice the number of keys).]
+ */
+void StateCounter::rehash( const std::size_t& capacity )
+{
+	// Move current table aside
+	std::vector<uint64_t> old_keys;   old_keys.swap(keys);
+	std::vector<unsigned> old_counts; old_counts.swap(counts);
+
+	keys.assign( capacity, 0 );
+	counts.assign( capacity, 0 );
+	filled.clear(); filled.reserve( capacity >> 1 );
+
+	// Reinsert
+	const std::size_t mask = keys.size() - 1;
+	for ( std::size_t i = 0; i < old_keys.size(); ++i ) if ( old_keys[i] )
+	{
+		std::size_t k = old_keys[i] & mask;
+		while ( keys[k] ) k = (k+1) & mask;
+
+		keys[k]   = old_keys[i];
+		counts[k] = old_counts[i];
+		filled.push_back(k);
+	}
+}
@@ -11,9 +11,16 @@
 //=============================================
 
 #include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
 #include <utility>
 #include <valarray>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 
 
 	/********************     **********     ********************/
@@ -114,4 +121,86 @@ private:
 
 
 
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * SplitMix64 finalizer, used to derive well-mixed 64 bits keys from integers.
+ */
+inline uint64_t mix64( uint64_t x )
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x  = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x  = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+
+
+/**
+ * Index of the first k < n such that a[k] == b[k], or n if there is none.
+ * Elements are compared four at a time with SSE2 when it is available.
+ */
+inline unsigned first_equal( const int *a, const int *b, const unsigned& n )
+{
+	unsigned k = 0;
+
+#ifdef __SSE2__
+	for ( ; k + 4 <= n; k += 4 )
+	{
+		const __m128i eq = _mm_cmpeq_epi32( 
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>(a+k) ), 
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>(b+k) ) );
+
+		const int mask = _mm_movemask_ps( _mm_castsi128_ps(eq) );
+		if ( mask ) return k + __builtin_ctz(mask);
+	}
+#endif
+
+	for ( ; k < n; ++k ) if ( a[k] == b[k] ) return k;
+	return n;
+}
+
+
+
+/**
+ * Count the occurrences of 64 bits keys (e.g. hashed states) in an open-addressing table.
+ * The key 0 is reserved to mark empty slots. Memory is kept across clear() calls, which
+ * only reset the slots in use.
+ */
+class StateCounter
+{
+public:
+
+	// Ctor
+	StateCounter() : n_keys(0) {}
+
+	// Forget all keys (but keep memory)
+	void clear();
+
+	// Make room for n distinct keys
+	void reserve( const unsigned& n );
+
+	// Increment the count of key, and return the new count
+	unsigned increment( uint64_t key );
+
+	// Number of distinct keys
+	inline unsigned size() const { return n_keys; }
+
+private:
+
+	// Change the capacity (a power of two) and rehash
+	void rehash( const std::size_t& capacity );
+
+	// Members
+	// 
+	std::vector<uint64_t> keys;
+	std::vector<unsigned> counts, filled;
+	unsigned n_keys;
+};
+
+
+
 #endif
\ No newline at end of file
@@ -16,6 +16,32 @@
 
 
 
+/**
+ * Scratch space of the calling thread, shared by the forests it generates and copies.
+ * It keeps its storage from one forest to the next, and can be reserved for the largest
+ * forests up front (see Forest::reserve).
+ */
+struct ForestScratch
+{
+	CUR_Graph cur;
+	std::vector<bool> graph, part_graph;
+	std::vector<unsigned> cumsum, sequence, degree, queue, local, small, large, cursor;
+	std::vector<double> weights;
+
+	static inline ForestScratch& get()
+	{
+		static thread_local ForestScratch scratch;
+		return scratch;
+	}
+};
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
 /**
  * Generate a random degree sequence (with di >= 1 for all i).
  * d's size must be >= 2.
@@ -23,21 +49,17 @@
  * Each element of d will be sampled from the uniform integer distribution
  * on {1, 2, .., n-1}.
  */
-void generate_degree_sequence( std::valarray<unsigned>& d )
+void generate_degree_sequence( std::vector<unsigned>& d )
 {
 	// Safety check
 	const unsigned n = d.size();
 	if ( n < 2 ) return;
 
-	// Create uniform distribution
-	std::uniform_int_distribution<unsigned> U(1, n-1);
-	std::mt19937 *engine = MersenneTwister::get_engine();
-
-	// Create iterator
-	valarray_bounds<unsigned> bounds(d);
+	// Random engine of the thread
+	BulkRandom *engine = BulkRandom::get_engine();
 
 	// Generate n random integers between 1 and (n-1)
-	if (bounds) for ( auto it = bounds.begin(); it != bounds.end(); ) *it++ = U( *engine );
+	for ( auto it = d.begin(); it != d.end(); ) *it++ = 1 + engine->bounded(n-1);
 }
 
 
@@ -55,14 +77,14 @@ void generate_degree_sequence( std::valarray<unsigned>& d )
  * 
  * d's size must be >= 2.
  */
-bool graphic_sequence_test( const std::valarray<unsigned>& d )
+bool graphic_sequence_test( const std::vector<unsigned>& d )
 {
 	// Safety check
 	const unsigned n = d.size();
 	if ( n < 2 ) return false;
 
 	// Storage for cumulative sum of d
-	static std::valarray<unsigned> cs;
+	std::vector<unsigned>& cs = ForestScratch::get().cumsum;
 
 	// Resize cumulative sum and set first element
 	cs.resize(n-1); cs[0] = d[0];
@@ -104,7 +126,7 @@ bool graphic_sequence_test( const std::valarray<unsigned>& d )
  * Each element of d will be sampled from the uniform integer distribution
  * on {1, 2, .., n-1}.
  */
-void generate_graphic_sequence( std::valarray<unsigned>& d )
+void generate_graphic_sequence( std::vector<unsigned>& d )
 {
 	// Safety check
 	if ( d.size() < 2 ) return;
@@ -115,7 +137,7 @@ void generate_graphic_sequence( std::valarray<unsigned>& d )
 	while ( !success )
 	{
 		generate_degree_sequence(d);
-		success = graphic_sequence_test(d);
+		if ( !(success = graphic_sequence_test(d)) ) Counters::add( COUNTER_SEQUENCE_REJECTIONS );
 	}
 }
 
@@ -126,32 +148,58 @@ void generate_graphic_sequence( std::valarray<unsigned>& d )
 
 
 
+/**
+ * Neumaier's compensated summation: add x to the sum s, whose rounding error is accumulated in c.
+ * The compensated sum is s+c, whose error does not grow with the number of terms.
+ */
+static inline double compensated_add( double& s, double& c, const double& x )
+{
+	const double t = s + x;
+	c += std::abs(s) >= std::abs(x) ? (s - t) + x : (x - t) + s;
+	return (s = t) + c;
+}
+
+
+
+/**
+ * [CUR_Graph::reserve Reserve the storage of graphs with up to n vertices.]
+ * @param n [Number of vertices.]
+ */
+void CUR_Graph::reserve( const unsigned& n )
+{
+	probabilities.reserve( n*(n+1) >> 1 );
+	degrees.reserve(n);
+}
+
+
+
 /**
  * [CUR_Graph::initialize Initialize generation variables.]
  * @param d [Prescribed degrees for the generated graph.]
  */
-void CUR_Graph::initialize( const std::valarray<unsigned>& d )
+void CUR_Graph::initialize( const std::vector<unsigned>& d )
 {
 	// Initialize variables
 	n = d.size(); p_sum = 0.0;
 
-	// Resize both valarrays
-	probabilities.resize( n*(n+1) >> 1, 0.0 );
-	degrees.resize(n); degrees = d;
+	// Reset both vectors (the diagonal terms stay at zero)
+	probabilities.assign( n*(n+1) >> 1, 0.0 );
+	degrees.assign( d.begin(), d.end() );
 
 	// Compute number of edges
-	remaining_edges = degrees.sum() >> 1;
+	remaining_edges = std::accumulate( degrees.begin(), degrees.end(), 0u ) >> 1;
 	const double m  = static_cast<double>(remaining_edges << 2);
 
 	// Compute initial probabilities
-	double *p = &probabilities[1];
+	double *p = &probabilities[1], c = 0.0;
 
 	for ( unsigned j = 0; j < n-1; ++j, ++p )
 	for ( unsigned i = j+1; i < n; ++i )
 	{
-		*p     = 1.0 - (d[i] * d[j]) / m;
-		p_sum += (d[i] * d[j]) * *p++;
+		*p = std::max( 0.0, 1.0 - (d[i] * d[j]) / m ); // negative weights are not sampled
+		compensated_add( p_sum, c, (d[i] * d[j]) * *p++ );
 	}
+	p_sum += c;
 }
 
 
@@ -166,37 +214,47 @@ double CUR_Graph::sum_probabilities() const
 	const unsigned* d = &degrees[0];
 	const double* p   = &probabilities[1];
 
-	// Compute sum
-	p_sum = 0.0;
+	// Compute compensated sum (there are O(n^2) terms)
+	double s = 0.0, c = 0.0;
 	for ( unsigned j = 0; j < n-1; ++j, ++p )
 	for ( unsigned i = j+1; i < n; ++i )
-		p_sum += (d[i]*d[j]) * *p++;
+		compensated_add( s, c, (d[i]*d[j]) * *p++ );
 
-	return p_sum;
+	return p_sum = s + c;
 }
 
 
 
 /**
  * [CUR_Graph::sis_select Random selection of an edge using Sequence Importance Sampling.]
- * @return [Plain index in the probability matrix, equiv. to an edge index.]
+ * The CDF is accumulated with compensation, and if rounding still lets the level run past its 
+ * end, the last edge of positive weight is selected (the level is below the total weight).
+ * @param  edge [Output plain index in the probability matrix, equiv. to an edge index.]
+ * @return      [False if no edge has a positive weight.]
  */
-unsigned CUR_Graph::sis_select() const
+bool CUR_Graph::sis_select( unsigned& edge ) const
 {
-	// Static uniform distribution in [0,1)
-	static std::uniform_real_distribution<double> U(0.0, 1.0);
+	// Sample random number in [0,1) and match level on corresponding CDF
+	const double level = p_sum * BulkRandom::get_engine()->real();
+	unsigned last = 0, i = 1, j = 0;
+	double cdf = 0.0, c = 0.0;
 
-	// Sample random number and match level on corresponding CDF
-	const double level = p_sum * U( *MersenneTwister::get_engine() );
-	unsigned edge = 0, i = 1, j = 0;
-
-	// NOTE: probabilities[0] is 0.0 by construction
-	for ( double cdf = 0.0; 
-		level >= (cdf += degrees[i]*degrees[j] * probabilities[++edge]); )
-		if ( ++i % n == 0 ) if ( (i = ++j) == n ) throw; // Irrecoverable loss of precision
+	// NOTE: probabilities[0] is 0.0 by construction, and so are the diagonal terms
+	for ( edge = 1; ; ++edge )
+	{
+		const double w = degrees[i]*degrees[j] * probabilities[edge];
+		if ( w > 0.0 ) 
+		{
+			if ( level < compensated_add( cdf, c, w ) ) return true;
+			last = edge;
+		}
+
+		if ( ++i % n == 0 ) if ( (i = ++j) == n ) break;
+	}
 
-	// Return selected edge
-	return edge;
+	// Guarded last bucket
+	Counters::add( COUNTER_SIS_FAILURES );
+	return (edge = last) != 0;
 }
 
 
@@ -232,10 +290,13 @@ void CUR_Graph::update( const unsigned& selected_edge, graph_type& G )
  * with symmetric column storage convention.]
  * @param G [Must be bool[ n(n+1)/2 ] initialized to false.]
  */
-void CUR_Graph::generate( graph_type& G )
+bool CUR_Graph::generate( graph_type& G )
 {
 	// Iterate selection and update until no more edge can be selected
-	while ( remaining_edges ) update(sis_select(),G);
+	for ( unsigned edge; remaining_edges; update(edge,G) )
+		if ( !sis_select(edge) ) return false;
+
+	return true;
 }
 
 
@@ -252,21 +313,64 @@ void CUR_Graph::generate( graph_type& G )
  * Algorithmica 4, vol. 58, 860-910, 2010
  *
  * d's size must be >= 2., G's must be a n(n+1)/2 initialized to false.
+ * Returns false if the sampling failed, in which case G should be discarded.
  */
-void generate_cur_graph( const std::valarray<unsigned>& d, std::vector<bool>& G )
+bool generate_cur_graph( const std::vector<unsigned>& d, std::vector<bool>& G )
 {
-	// Static CUR_Graph instance
-	static CUR_Graph graph;
+	// CUR_Graph instance of the thread
+	CUR_Graph& graph = ForestScratch::get().cur;
 
 	// Safety checks
 	const unsigned n = d.size();
-	if ( (n < 2) || (G.size() != (n*(n+1)>>1)) ) return;
+	if ( (n < 2) || (G.size() != (n*(n+1)>>1)) ) return false;
 
 	// Initialize graph generator
 	graph.initialize(d);
 
 	// Generate new graph
-	graph.generate(G);
+	return graph.generate(G);
+}
+
+
+
+/**
+ * Generate a uniformly random labelled tree with n vertices.
+ * Each tree corresponds to exactly one Prüfer sequence of length n-2, which is decoded
+ * by repeatedly attaching the smallest leaf to the next element of the sequence.
+ */
+void generate_random_tree( const unsigned& n, std::vector<bool>& G )
+{
+	std::vector<unsigned>& sequence = ForestScratch::get().sequence;
+	std::vector<unsigned>& degree   = ForestScratch::get().degree;
+	static SMCSIndexer indexer;
+
+	// Safety checks
+	if ( (n < 2) || (G.size() != (n*(n+1)>>1)) ) return;
+
+	// Random Prüfer sequence, and degrees of the corresponding tree
+	BulkRandom *engine = BulkRandom::get_engine();
+
+	sequence.resize( n-2 );
+	degree.assign( n, 1 );
+	for ( auto it = sequence.begin(); it != sequence.end(); ++it ) 
+		++degree[ *it = engine->bounded(n) ];
+
+	// Decode
+	unsigned ptr = 0; 
+	while ( degree[ptr] != 1 ) ++ptr;
+	unsigned leaf = ptr;
+
+	for ( auto it = sequence.begin(); it != sequence.end(); ++it )
+	{
+		const unsigned v = *it;
+		G[ indexer.sub2ind(n,leaf,v) ] = true;
+
+		// The next leaf is v if it just became a leaf before ptr, or the next one after ptr
+		if ( --degree[v] == 1 && v < ptr ) leaf = v;
+		else { ++ptr; while ( degree[ptr] != 1 ) ++ptr; leaf = ptr; }
+	}
+
+	G[ indexer.sub2ind(n,leaf,n-1) ] = true;
 }
 
 
@@ -281,10 +385,14 @@ void generate_cur_graph( const std::valarray<unsigned>& d, std::vector<bool>& G
  */
 void Forest::clear()
 {
-	// Destruct valarrays
-	degrees.~valarray();
-	strides.~valarray();
+	// Storage is kept
+	degrees.clear();
+	strides.clear();
 	neighbors.clear();
+	components.clear(); colors.clear();
+	clear_jumps();
+	n_components = 0;
+	is_bipartite = false;
 
 	// Reset number of trees
 	n_trees = 0;
@@ -292,6 +400,38 @@ void Forest::clear()
 
 
 
+/**
+ * [Forest::reserve Reserve the storage of forests with up to n trees, so that generating 
+ * or copying them doesn't allocate.]
+ * The neighbors and the jumps are bounded by the complete graph. The scratch space is 
+ * shared by the forests of the calling thread, so the thread which uses the forest 
+ * should call this.
+ * @param n [Max number of trees.]
+ */
+void Forest::reserve( const unsigned& n )
+{
+	// Each edge appears twice in the neighbors
+	const unsigned n_entries = n ? n*(n-1) : 0, n_pairs = n*(n+1) >> 1;
+
+	degrees.reserve(n); strides.reserve(n+1);
+	neighbors.reserve(n_entries);
+	components.reserve(n); colors.reserve(n);
+	jumps.reserve(n_entries); alias_prob.reserve(n_entries);
+	reverse.reserve(n_entries); alias.reserve(n_entries);
+
+	// Scratch space of the thread
+	ForestScratch& s = ForestScratch::get();
+
+	s.cur.reserve(n);
+	s.graph.reserve(n_pairs); s.part_graph.reserve(n_pairs);
+	s.cumsum.reserve(n); s.sequence.reserve(n); s.degree.reserve(n);
+	s.queue.reserve(n); s.local.reserve(n);
+	s.small.reserve(n); s.large.reserve(n); s.cursor.reserve(n);
+	s.weights.reserve(n_entries);
+}
+
+
+
 /**
  * [Forest::print Display contents in stdout.]
  */
@@ -327,8 +467,8 @@ void Forest::print() const
  */
 void Forest::generate( const unsigned& n )
 {
-	// Static graph container
-	static std::vector<bool> graph;
+	// Graph container of the thread
+	std::vector<bool>& graph = ForestScratch::get().graph;
 
 	// Safety check
 	if ( n < 2 ) return;
@@ -336,9 +476,9 @@ void Forest::generate( const unsigned& n )
 	// Set number of trees
 	n_trees = n;
 
-	// Resize degrees and strides
-	degrees.resize(n,1);
-	strides.resize(n+1,0);
+	// Reset degrees and strides
+	degrees.assign(n,1);
+	strides.assign(n+1,0);
 
 	// Allocate boolean adjacency matrix
 	const unsigned gsize = n*(n+1) >> 1;
@@ -355,20 +495,90 @@ void Forest::generate( const unsigned& n )
 		// Generate random graphical sequence of degrees
 		generate_graphic_sequence(degrees);
 
-		// Make a reasonnable assumption about the number of edges
+		// Each edge appears twice in the neighbors, so the complete graph bounds their number
 		neighbors.clear();
-		neighbors.reserve( degrees.sum() >> 1 );
+		neighbors.reserve( n*(n-1) );
+
+		// Generate random graph, and set neighbors and strides
+		success = generate_cur_graph(degrees,graph) && postgen_set(graph);
+		if ( !success ) Counters::add( COUNTER_FOREST_RESTARTS );
+	}
+}
+
+
+
+/**
+ * [Forest::generate_tree Generate a new forest with n trees, which is a uniformly random tree.]
+ * @param n [Number of trees (>=2).]
+ */
+void Forest::generate_tree( const unsigned& n )
+{
+	// Graph container of the thread
+	std::vector<bool>& graph = ForestScratch::get().graph;
+
+	// Safety check
+	if ( n < 2 ) return;
+
+	// Set number of trees
+	n_trees = n;
+
+	// Reset degrees and strides
+	degrees.assign(n,1);
+	strides.assign(n+1,0);
 
-		// Generate random graph
-		generate_cur_graph(degrees,graph);
+	// Generate random tree
+	graph.assign( n*(n+1) >> 1, false );
+	generate_random_tree(n,graph);
 
-		// Set neighbors and strides
-		success = postgen_set(graph);
+	// Set neighbors and strides (a tree has no isolated vertex)
+	neighbors.clear();
+	neighbors.reserve( 2*(n-1) );
+	postgen_set(graph);
+}
+
+
+
+/**
+ * [Forest::generate Generate a new forest with n trees using a given generator.]
+ * @param n         [Number of trees (>=2).]
+ * @param generator [Random graph model.]
+ */
+void Forest::generate( const unsigned& n, const ForestGenerator& generator )
+{
+	switch ( generator )
+	{
+		case TREE_GENERATOR: generate_tree(n); break;
+		default:             generate(n);      break;
 	}
 }
 
 
 
+/**
+ * [Forest::assign Set the forest from a given graph.]
+ * @param  n [Number of trees (>=2).]
+ * @param  G [Adjacency matrix with symmetric column storage, as in generate_cur_graph().]
+ * @return   [False if a tree has no neighbor.]
+ */
+bool Forest::assign( const unsigned& n, const graph_type& G )
+{
+	// Safety check
+	if ( n < 2 || G.size() != (n*(n+1) >> 1) ) return false;
+
+	// Set number of trees
+	n_trees = n;
+
+	// Reset degrees and strides
+	degrees.assign(n,1);
+	strides.assign(n+1,0);
+
+	// Set neighbors and strides
+	neighbors.clear();
+	return postgen_set(G);
+}
+
+
+
 /**
  * [Forest::set_neighborhoods Private method to populate the neighbors array 
  * from a generated graph.]
@@ -380,6 +590,9 @@ bool Forest::postgen_set( const graph_type& G )
 	// Static indexer
 	static SMCSIndexer indexer;
 
+	// The jumps of the previous forest are meaningless
+	clear_jumps();
+
 	// Fill neighbors
 	for ( unsigned tree = 0; tree < n_trees; ++tree )
 	{
@@ -398,12 +611,101 @@ bool Forest::postgen_set( const graph_type& G )
 		if ( (degrees[tree] = strides[tree+1] - strides[tree]) == 0) return false;
 	}
 
+	// Detect connected parts and bipartite forests
+	set_components();
+
 	// Report success
 	return true;
 }
 
 
 
+/**
+ * [Forest::set_components Private method to find the connected parts of the forest and
+ * 2-color the trees by breadth-first search.]
+ * Each part is numbered and colored from its smallest tree; the forest is bipartite iff
+ * no edge joins two trees of the same class.
+ */
+void Forest::set_components()
+{
+	vector_type& queue = ForestScratch::get().queue;
+
+	const unsigned none = n_trees;
+	components.assign( n_trees, none );
+	colors.assign( n_trees, 0 );
+	queue.resize( n_trees );
+
+	n_components = 0;
+	is_bipartite = true;
+
+	for ( unsigned root = 0; root < n_trees; ++root ) if ( components[root] == none )
+	{
+		unsigned head = 0, tail = 0;
+		components[root] = n_components; queue[tail++] = root;
+
+		while ( head < tail )
+		{
+			const unsigned t = queue[head++];
+
+			for ( unsigned e = strides[t]; e < strides[t+1]; ++e )
+			{
+				const unsigned u = neighbors[e];
+
+				if ( components[u] == none ) 
+				{ 
+					components[u] = n_components; 
+					colors[u] = 1 - colors[t]; 
+					queue[tail++] = u; 
+				}
+				else if ( colors[u] == colors[t] ) is_bipartite = false;
+			}
+		}
+
+		++n_components;
+	}
+
+	if ( !is_bipartite ) colors.clear();
+}
+
+
+
+/**
+ * [Forest::extract_component Copy a connected part as a forest of its own.]
+ * The trees of the part keep their order, so a connected forest is copied as is.
+ * @param  c     [Index of the part.]
+ * @param  part  [Output forest.]
+ * @param  trees [Output tree of the forest for each tree of the part.]
+ * @return       [False if there is no such part.]
+ */
+bool Forest::extract_component( const unsigned& c, Forest& part, vector_type& trees ) const
+{
+	graph_type&  graph = ForestScratch::get().part_graph;
+	vector_type& local = ForestScratch::get().local;
+	static SMCSIndexer indexer;
+
+	if ( c >= n_components ) return false;
+
+	// Trees of the part, and their index in the part
+	trees.clear(); local.resize( n_trees );
+	for ( unsigned t = 0; t < n_trees; ++t ) 
+		if ( components[t] == c ) { local[t] = trees.size(); trees.push_back(t); }
+
+	// Adjacency of the part
+	const unsigned n = trees.size();
+	graph.assign( n*(n+1) >> 1, false );
+
+	for ( unsigned i = 0; i < n; ++i )
+	for ( unsigned e = strides[ trees[i] ]; e < strides[ trees[i]+1 ]; ++e )
+	{
+		const unsigned j = local[ neighbors[e] ];
+		if ( j < i ) graph[ indexer.sub2ind(n,i,j) ] = true;
+	}
+
+	return part.assign( n, graph );
+}
+
+
+
 /**
  * [Forest::random_neighbor Simulate a random jump from the input tree using the adjacency 
  * structure of the forest.]
@@ -412,11 +714,152 @@ bool Forest::postgen_set( const graph_type& G )
  */
 unsigned Forest::random_neighbor( const unsigned& tree ) const
 {
-	// Create uniform distribution
-	std::uniform_int_distribution<unsigned> U( 0, degrees[tree]-1 );
+	BulkRandom *engine = BulkRandom::get_engine();
+
+	// Pick a column of the alias table uniformly
+	const unsigned e = strides[tree] + engine->bounded( degrees[tree] );
+
+	// Weighted jumps: keep the column or take its alias
+	if ( weighted() && engine->real() >= alias_prob[e] ) 
+		return neighbors[ strides[tree] + alias[e] ];
 
 	// Return random neighbor
-	return neighbors.at( strides[tree] + U( *MersenneTwister::get_engine() ) );
+	return neighbors.at(e);
+}
+
+
+
+/**
+ * [Forest::set_jumps Set the weights of Bob's jumps, and build the alias tables.]
+ * The weights of each tree are normalized to transition probabilities, and split into
+ * a Vose alias table with one column per neighbor, so that a jump costs two draws 
+ * whatever the degree:
+ *
+ * Vose, M.D. "A Linear Algorithm for Generating Random Numbers with a Given Distribution"
+ * IEEE Transactions on Software Engineering 17, vol. 9, 972-975, 1991
+ * 
+ * @param  w [Positive weight of each entry of neighbors.]
+ * @return   [False if the weights don't match the forest.]
+ */
+bool Forest::set_jumps( const std::vector<double>& w )
+{
+	std::vector<unsigned>& small  = ForestScratch::get().small;
+	std::vector<unsigned>& large  = ForestScratch::get().large;
+	std::vector<unsigned>& cursor = ForestScratch::get().cursor;
+
+	// Safety checks
+	const unsigned n_edges = neighbors.size();
+	if ( !n_trees || w.size() != n_edges ) return false;
+	for ( unsigned e = 0; e < n_edges; ++e ) 
+		if ( !(w[e] > 0.0) || !std::isfinite(w[e]) ) return false;
+
+	jumps.resize(n_edges); 
+	alias_prob.resize(n_edges); 
+	alias.resize(n_edges);
+
+	for ( unsigned t = 0; t < n_trees; ++t )
+	{
+		const unsigned b = strides[t], d = degrees[t];
+
+		// Normalize
+		double sum = 0.0;
+		for ( unsigned k = 0; k < d; ++k ) sum += w[b+k];
+		for ( unsigned k = 0; k < d; ++k ) jumps[b+k] = w[b+k] / sum;
+
+		// Split the columns whose scaled probability is below and above one
+		small.clear(); large.clear();
+		for ( unsigned k = 0; k < d; ++k )
+		{
+			alias_prob[b+k] = d * jumps[b+k];
+			(alias_prob[b+k] < 1.0 ? small : large).push_back(k);
+		}
+
+		// Fill each small column with the excess of a large one
+		while ( !small.empty() && !large.empty() )
+		{
+			const unsigned s = small.back(), l = large.back(); small.pop_back();
+
+			alias[b+s] = l;
+			alias_prob[b+l] = (alias_prob[b+l] + alias_prob[b+s]) - 1.0;
+
+			if ( alias_prob[b+l] < 1.0 ) { large.pop_back(); small.push_back(l); }
+		}
+
+		// The remaining columns are full (up to rounding)
+		for ( auto it = large.begin(); it != large.end(); ++it ) { alias_prob[b+*it] = 1.0; alias[b+*it] = *it; }
+		for ( auto it = small.begin(); it != small.end(); ++it ) { alias_prob[b+*it] = 1.0; alias[b+*it] = *it; }
+	}
+
+	// Opposite entries. Each row lists the greater neighbors first, then the smaller ones in 
+	// increasing order (see postgen_set), so the latter are met in order when scanning trees.
+	reverse.resize(n_edges);
+	cursor.resize(n_trees);
+	for ( unsigned u = 0; u < n_trees; ++u )
+	{
+		cursor[u] = strides[u];
+		while ( cursor[u] < strides[u+1] && neighbors[cursor[u]] > u ) ++cursor[u];
+	}
+
+	for ( unsigned t = 0; t < n_trees; ++t )
+	for ( unsigned e = strides[t]; e < strides[t+1]; ++e )
+	{
+		const unsigned u = neighbors[e];
+		if ( u < t ) continue;
+
+		const unsigned r = cursor[u]++;
+		reverse[e] = r; reverse[r] = e;
+	}
+
+	return true;
+}
+
+
+
+/**
+ * [Forest::generate_jumps Draw the weights of Bob's jumps.]
+ * @param model [Law of the weights.]
+ */
+void Forest::generate_jumps( const JumpModel& model )
+{
+	std::vector<double>& w = ForestScratch::get().weights;
+
+	const unsigned n_edges = neighbors.size();
+	w.resize(n_edges);
+
+	switch ( model )
+	{
+		case RANDOM_JUMPS:
+		{
+			// Normalized exponential weights are uniform on the simplex
+			BulkRandom *engine = BulkRandom::get_engine();
+
+			// (zero has almost no chance, but is not a valid weight)
+			for ( unsigned e = 0; e < n_edges; ++e ) 
+				w[e] = std::max( -std::log( 1.0 - engine->real() ), 1e-300 );
+			break;
+		}
+
+		case DEGREE_JUMPS:
+			for ( unsigned e = 0; e < n_edges; ++e ) w[e] = degrees[ neighbors[e] ];
+			break;
+
+		default: 
+			clear_jumps(); 
+			return;
+	}
+
+	set_jumps(w);
+}
+
+
+
+/**
+ * [Forest::clear_jumps Make Bob jump uniformly.]
+ */
+void Forest::clear_jumps()
+{
+	jumps.clear(); alias_prob.clear();
+	reverse.clear(); alias.clear();
 }
 
 
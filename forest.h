@@ -12,11 +12,13 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <cmath>
 #include <vector>
-#include <valarray>
+#include <numeric>
 #include <algorithm>
 #include "random_engine.h"
 #include "data_structures.h"
+#include "counters.h"
 
 
 
@@ -29,7 +31,7 @@
  * Generate a random degree sequence (with di >= 1 for all i).
  * d's size must be >= 2.
  */
-void generate_degree_sequence( std::valarray<unsigned>& d );
+void generate_degree_sequence( std::vector<unsigned>& d );
 
 
 
@@ -41,7 +43,7 @@ void generate_degree_sequence( std::valarray<unsigned>& d );
  * 
  * d's size must be >= 2.
  */
-bool graphic_sequence_test( const std::valarray<unsigned>& d );
+bool graphic_sequence_test( const std::vector<unsigned>& d );
 
 
 
@@ -49,7 +51,7 @@ bool graphic_sequence_test( const std::valarray<unsigned>& d );
  * Generate a random graphic degree sequence (with di >= 1 for all i).
  * d's size must be >= 2.
  */
-void generate_graphic_sequence( std::valarray<unsigned>& d );
+void generate_graphic_sequence( std::vector<unsigned>& d );
 
 
 
@@ -66,16 +68,19 @@ public:
 
 	typedef std::vector<bool> graph_type;
 
+	// Reserve the storage of graphs with up to n vertices
+	void reserve( const unsigned& n );
+
 	// Initialize generator from prescribed degrees
-	void initialize( const std::valarray<unsigned>& d );
+	void initialize( const std::vector<unsigned>& d );
 
-	// Generate adjacency matrix (symmetric column storage)
-	void generate( graph_type& G );
+	// Generate adjacency matrix (symmetric column storage), false if the sampling failed
+	bool generate( graph_type& G );
 
 private:
 
-	// Sequence Importance Sampling selection of edges
-	unsigned sis_select() const;
+	// Sequence Importance Sampling selection of edges, false if no edge can be selected
+	bool sis_select( unsigned& edge ) const;
 
 	// Update post edge-selection
 	void update( const unsigned& selected_edge, graph_type& G );
@@ -85,8 +90,8 @@ private:
 
 	// Members
 	// 
-	std::valarray<double>   probabilities;
-	std::valarray<unsigned> degrees;
+	std::vector<double>   probabilities;
+	std::vector<unsigned> degrees;
 
 	unsigned n, remaining_edges;
 	mutable double p_sum;
@@ -97,7 +102,31 @@ private:
 /**
  * Call this method to generate a CUR graph.
  */
-void generate_cur_graph( const std::valarray<unsigned>& d, std::vector<bool>& G );
+bool generate_cur_graph( const std::vector<unsigned>& d, std::vector<bool>& G );
+
+
+
+/**
+ * Generate a uniformly random labelled tree with n vertices, by decoding a random
+ * Prüfer sequence in linear time. G uses the same storage as generate_cur_graph().
+ */
+void generate_random_tree( const unsigned& n, std::vector<bool>& G );
+
+
+
+/**
+ * Random graphs that can be used to generate forests.
+ */
+enum ForestGenerator { CUR_GENERATOR, TREE_GENERATOR };
+
+
+
+/**
+ * Laws of Bob's jumps. Uniform jumps pick a neighbor uniformly at random; random jumps
+ * draw the weights of each tree from a flat Dirichlet distribution; degree jumps prefer 
+ * the neighbors with many neighbors of their own.
+ */
+enum JumpModel { UNIFORM_JUMPS, RANDOM_JUMPS, DEGREE_JUMPS };
 
 
 
@@ -118,11 +147,14 @@ class Forest // ... run!!
 {
 public:
 
+	// Ctor
+	Forest() : n_trees(0), n_components(0), is_bipartite(false) {}
+
 	/********************     **********     ********************/
 
 	typedef std::vector<bool>       graph_type;
 	typedef std::vector<unsigned>   vector_type;
-	typedef std::valarray<unsigned> array_type;
+	typedef std::vector<unsigned>   array_type;
 
 	typedef std::pair<unsigned,unsigned> agl_pair_type;
 	typedef std::vector<agl_pair_type>   agl_vector_type;
@@ -135,9 +167,21 @@ public:
 	// Reset member data.
 	void clear();
 
+	// Reserve storage for forests with up to n trees, and the scratch space of the calling thread.
+	void reserve( const unsigned& n );
+
 	// Generate a random forest with n trees.
 	void generate( const unsigned& n );
 
+	// Generate a random forest with n trees, which is itself a tree.
+	void generate_tree( const unsigned& n );
+
+	// Generate a random forest with the given generator.
+	void generate( const unsigned& n, const ForestGenerator& generator );
+
+	// Set the forest from an adjacency matrix (symmetric column storage) with n trees.
+	bool assign( const unsigned& n, const graph_type& G );
+
 	// Display contents to stdout
 	void print() const;
 
@@ -146,6 +190,21 @@ public:
 	// Return a random neighbor of the input tree. This simulates a "jump".
 	unsigned random_neighbor( const unsigned& tree ) const;
 
+	// Set the weight of each jump (one per entry of neighbors), normalized for each tree.
+	bool set_jumps( const std::vector<double>& w );
+
+	// Draw the weights of the jumps from a given model.
+	void generate_jumps( const JumpModel& model );
+
+	// Go back to uniform jumps.
+	void clear_jumps();
+
+	// Are the jumps weighted?
+	inline bool weighted() const { return !jumps.empty(); }
+
+	// Can the trees be split in two classes, such that Bob always jumps to the other class?
+	inline bool bipartite() const { return is_bipartite; }
+
 	/********************     **********     ********************/
 
 	// Return the current number of trees.
@@ -156,6 +215,21 @@ public:
 	inline const array_type&  get_degrees() const { return degrees; }
 	inline const array_type&  get_strides() const { return strides; }
 
+	// Probability of the jump along each entry of neighbors, and index of the opposite 
+	// entry (only if the jumps are weighted)
+	inline const std::vector<double>& get_jumps() const { return jumps; }
+	inline const vector_type&         get_reverse() const { return reverse; }
+
+	// Class (0 or 1) of each tree in a 2-coloring (only if the forest is bipartite)
+	inline const vector_type& get_colors() const { return colors; }
+
+	// Connected part of each tree (numbered by smallest tree), and number of parts
+	inline const vector_type& get_components() const { return components; }
+	inline const unsigned&    get_n_components() const { return n_components; }
+
+	// Copy a connected part (without weights), and the tree of the forest for each tree of the part
+	bool extract_component( const unsigned& c, Forest& part, vector_type& trees ) const;
+
 	// Export in ACM format for Angelo
 	void acm_export( agl_pair_type& cfg, agl_vector_type& cx ) const;
 
@@ -166,12 +240,24 @@ private:
 	// Set member data after generating forest
 	bool postgen_set( const graph_type& G );
 
+	// Find the connected parts and a 2-coloring of the trees
+	void set_components();
+
 	// Members
 	// 
 	array_type  degrees, strides;
 	vector_type neighbors;
 	unsigned n_trees;
 
+	// Connected parts and 2-coloring
+	vector_type components, colors;
+	unsigned n_components;
+	bool is_bipartite;
+
+	// Weighted jumps, with a Vose alias table in each row of neighbors
+	std::vector<double> jumps, alias_prob;
+	vector_type reverse, alias;
+
 };
 
 #endif
\ No newline at end of file
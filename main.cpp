@@ -1,5 +1,6 @@
 #include <vector>
 #include "benchmark.h"
+#include "sweep.h"
 
 //=============================================
 // @filename     main.cpp
@@ -12,50 +13,201 @@
 
 
 
-int main()
+int main( int argc, char **argv )
 {
-	// Create both hunters
+	// Parse the sweep (see SweepSpec, or run with --help)
+	SweepSpec spec;
+	if ( !spec.parse( argc, argv ) ) return 1;
+
+	std::vector<SweepSize> sizes;
+	if ( !spec.build( sizes ) ) return 1;
+
+	// Create hunters
 	Jonathan jonathan;
 	Angelo angelo;
+	Sweeper sweeper;
+
+	// Single precision variant of Jonathan, to check that plans don't change
+	BasicJonathan<float> jonathan_float;
+	PlanComparison comparison;
+	std::vector<VerificationStatistics> verification;
+	std::vector<EvaluationStatistics> evaluation;
+
+	// With --plan-cache, share Angelo's plans between isomorphic forests across runs (the plans
+	// only depend on the isomorphism class, so shots don't depend on the contents of the cache, 
+	// but his setup times do: the cache is off by default, and recorded in the outputs)
+	const bool use_cache = !spec.plan_cache_file.empty();
+	PlanCache cache; 
+	if ( use_cache ) 
+	{
+		cache.load( spec.plan_cache_file.c_str() );
+		angelo.set_cache( &cache );
+	}
 
 	// Create benchmark object
 	Benchmark benchmark;
 
-	// Set hunters
-	benchmark.set_hunters( &angelo, &jonathan );
+	// Register hunters
+	for ( auto h = spec.hunters.begin(); h != spec.hunters.end(); ++h )
+	{
+		if ( *h == "Angelo" )               benchmark.add_hunter( "Angelo", &angelo );
+		else if ( *h == "Jonathan" )        benchmark.add_hunter( "Jonathan", &jonathan );
+		else if ( *h == "Jonathan-float" )  benchmark.add_hunter( "Jonathan-float", &jonathan_float );
+		else if ( *h == "Sweeper" )         benchmark.add_hunter( "Sweeper", &sweeper );
+		else 
+		{
+			printf("Unknown hunter %s (Angelo, Jonathan, Jonathan-float or Sweeper).\n", h->c_str());
+			return 1;
+		}
+	}
+
+	// Room in the cache for a plan per part of each forest (parts have at least two trees, and
+	// plans have at most 4n shots, see Angelo::reserve), so that inserting doesn't allocate.
+	// With a target precision, the cap on the instances is used (the cache grows without one).
+	if ( use_cache && std::find( spec.hunters.begin(), spec.hunters.end(), "Angelo" ) != spec.hunters.end() )
+	{
+		const unsigned cap = spec.precision.enabled() ? spec.precision.max_instances : 0;
+
+		unsigned n_parts = 0, n_trees = 0;
+		for ( auto s = sizes.begin(); s != sizes.end(); ++s ) 
+		{
+			const unsigned instances = std::max( s->instances, cap );
+			n_parts += instances * (s->trees / 2);
+			n_trees += instances * s->trees;
+		}
+		cache.reserve( n_parts, n_trees, 4*n_trees );
+	}
+
+	// Configure the sweep
+	if ( spec.has_seed ) benchmark.set_seed( spec.seed );
+	benchmark.set_generator( spec.generator );
+	benchmark.set_jumps( spec.jumps );
+	benchmark.set_budget( spec.max_shots, spec.max_seconds );
+	benchmark.set_threads( spec.threads );
+	benchmark.set_counters( spec.counters );
+	benchmark.set_stratified( spec.stratified );
+	benchmark.set_precision( spec.precision );
+	benchmark.set_checkpoint( spec.checkpoint_file, spec.checkpoint_period );
+
+	if ( spec.counters )
+	{
+		PerfCounters probe;
+		if ( !probe.open() ) printf("Hardware counters are unavailable, events will not be reported.\n");
+	}
+
+	// Run all sizes on all cores, or one shard, or merge the shards
+	std::vector< std::vector<ResultsStatistics> > results;
+
+	if ( !spec.merge_files.empty() )
+	{
+		if ( !benchmark.merge_shards( spec.merge_files, sizes, results ) ) 
+		{
+			printf("Could not merge the shards. Aborting.\n");
+			return 1;
+		}
+	}
+	else
+	{
+		if ( spec.shard_count > 1 ) 
+		{
+			if ( spec.precision.enabled() ) printf("Target precisions are ignored by shards.\n");
+			benchmark.set_shard( spec.shard_index, spec.shard_count, spec.partial_file );
+		}
+
+		if ( !benchmark.run_sweep( sizes, results ) )
+		{
+			printf("An error occured during benchmark. Aborting.");
+			return 1;
+		}
+
+		if ( spec.shard_count > 1 ) 
+		{
+			printf("Shard %u/%u written to %s.\n", spec.shard_index, spec.shard_count, spec.partial_file.c_str());
+			return 0;
+		}
 
-	// Create testing data and storage
-	
-		/**
-		 * TEST FROM FOREST SIZE OF 6 TILL 21.
-		 * RUN N^2 INSTANCES FOR EACH BENCHMARK WITH N TREES.
-		 * RUN N TRIALS FOR EACH RANDOM FOREST WITH N TREES.
-		 */
-	 
-	const unsigned N = 16;
-	std::vector<ResultsStatistics> j_results(N), a_results(N);
+		// Number of instances actually run (with a target precision)
+		for ( unsigned i = 0; i < sizes.size(); ++i ) 
+			if ( !results[i].empty() ) sizes[i].instances = results[i][0].n_instances;
+	}
 
-	// Run benchmark
-	unsigned i = 0;
-	for ( unsigned n = 6; n < 22; ++n, ++i )
+	for ( unsigned i = 0; i < sizes.size(); ++i )
 	{
+		const unsigned n = sizes[i].trees;
+
 		// Notify
 		printf("******************************************\n");
-		printf("    STARTING BENCHMARK WITH %u TREES      \n", n);
+		printf("    BENCHMARK RESULTS WITH %u TREES      \n", n);
 		printf("******************************************\n");
 
-		// Setup benchmark
-		benchmark.setup( n, n*n, n );
+		// Setup benchmark (analyses run on the same forests)
+		benchmark.setup( n, sizes[i].instances, sizes[i].trials );
+
+		// Print results
+		for ( unsigned k = 0; k < benchmark.n_hunters(); ++k )
+			results[i][k].print( benchmark.hunter_name(k) );
 
-		// Run benchmark
-		if ( !benchmark.run( a_results[i], j_results[i] ) )
+		// Hardware events of the phases shared by all hunters
+		if ( benchmark.generation_counters(i).any() ) 
 		{
-			printf("An error occured during benchmark. Aborting.");
-			continue;
+			printf("Shared phases:\n");
+			benchmark.generation_counters(i).print( "Generation", "forest" );
+			benchmark.walk_counters(i).print( "Walk", "jump" );
 		}
 
-		// Print results
-		a_results[i].print("Angelo");
-		j_results[i].print("Jonathan");
+		// Retries, searches and rescalings
+		benchmark.event_counters(i).print( sizes[i].instances, "forest" );
+		if ( Allocations::tracking() ) benchmark.event_counters(i).print_allocations( sizes[i].instances, "forest" );
+
+		if ( !spec.analyses ) continue;
+
+		// Exact worst-case analysis of the plans
+		if ( benchmark.verify( n*n*n, verification ) )
+			for ( unsigned k = 0; k < benchmark.n_hunters(); ++k )
+				verification[k].print( benchmark.hunter_name(k) );
+
+		// Exact capture-time distribution against a random Bob
+		if ( benchmark.evaluate( n*n*n, evaluation ) )
+			for ( unsigned k = 0; k < benchmark.n_hunters(); ++k )
+				evaluation[k].print( benchmark.hunter_name(k) );
+
+		// Compare Jonathan's plans in single and double precision
+		if ( benchmark.compare( &jonathan, &jonathan_float, n*n, comparison ) )
+			comparison.print("Jonathan<float>");
+	}
+
+	// Save plans for the next run
+	if ( use_cache )
+	{
+		printf("Angelo's plan cache: %u entries, %u hits, %u misses\n", 
+			cache.size(), cache.hits(), cache.misses());
+		if ( !cache.save( spec.plan_cache_file.c_str() ) ) printf("Could not save the plan cache.\n");
+	}
+
+	// Machine-readable results
+	if ( !spec.json_file.empty() && !write_json( spec.json_file.c_str(), benchmark, sizes, results, use_cache ) ) 
+		printf("Could not write %s.\n", spec.json_file.c_str());
+	if ( !spec.csv_file.empty() && !write_csv( spec.csv_file.c_str(), benchmark, sizes, results, use_cache ) ) 
+		printf("Could not write %s.\n", spec.csv_file.c_str());
+
+	// Regressions w.r.t. a previous run
+	if ( !spec.baseline_file.empty() )
+	{
+		std::vector<Regression> regressions;
+		if ( !compare_baseline( spec.baseline_file.c_str(), benchmark, sizes, results, spec.alpha, regressions ) )
+		{
+			printf("Could not read the baseline %s.\n", spec.baseline_file.c_str());
+			return 1;
+		}
+
+		for ( auto r = regressions.begin(); r != regressions.end(); ++r )
+			printf("REGRESSION: %s with %u trees, %s mean %.6g -> %.6g (z=%.2f)\n", 
+				r->hunter.c_str(), r->trees, r->metric.c_str(), r->baseline, r->current, r->z);
+
+		printf("Baseline comparison: %u significant regressions (alpha=%g).\n", 
+			(unsigned) regressions.size(), spec.alpha);
+		if ( !regressions.empty() ) return 2;
 	}
-}
\ No newline at end of file
+
+	return 0;
+}
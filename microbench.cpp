@@ -0,0 +1,288 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <functional>
+#include "forest.h"
+#include "chuck.h"
+#include "statistics.h"
+#include "timer.h"
+
+//=============================================
+// @filename     microbench.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#define MICROBENCH_TARGET      0.02  // Relative half-width of the 95% confidence intervals
+#define MICROBENCH_MIN_SAMPLES 10
+#define MICROBENCH_MAX_SAMPLES 200
+#define MICROBENCH_SAMPLE_TIME 2e-3  // Seconds per sample
+#define MICROBENCH_POINT_TIME  2.0   // Max seconds per kernel and size
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * A hot path timed in isolation.
+ * prepare(n) builds the inputs for n trees (untimed), run(reps) calls the kernel 
+ * reps times and returns the number of operations that were done.
+ */
+struct Kernel
+{
+	const char *name;
+	unsigned max_n;
+	std::function<void(const unsigned&)> prepare;
+	std::function<unsigned(const unsigned&)> run;
+};
+
+/**
+ * Timing of one kernel for one size.
+ */
+struct Measure
+{
+	unsigned n, samples;
+	double ns, ci;
+	bool stable;
+};
+
+// Prevent the compiler from discarding the results of the kernels
+static volatile unsigned sink;
+
+
+
+/**
+ * [measure Time a kernel until the confidence interval of the time per operation is small enough.]
+ * @param  K      [The kernel.]
+ * @param  n      [Number of trees.]
+ * @param  target [Relative half-width of the 95% confidence interval.]
+ * @return        [Time per operation in nanoseconds.]
+ */
+Measure measure( const Kernel& K, const unsigned& n, const double& target )
+{
+	Stopwatch watch, total; StreamingStatistics S;
+	Measure M = { n, 0, 0.0, 0.0, false };
+
+	K.prepare(n);
+
+	// Calibrate the number of repetitions per sample
+	unsigned reps = 1, ops = 0; double t = 0.0;
+	for ( ;; reps *= 2 )
+	{
+		watch.start(); ops = K.run(reps); t = watch.stop();
+		if ( t >= MICROBENCH_SAMPLE_TIME || t >= MICROBENCH_POINT_TIME/MICROBENCH_MIN_SAMPLES ) break;
+	}
+
+	// Sample until the confidence interval is small enough
+	total.start();
+	while ( S.size() < MICROBENCH_MAX_SAMPLES )
+	{
+		watch.start(); ops = K.run(reps); t = watch.stop();
+		S.add( 1e9 * t / ops );
+
+		M.ci = 1.96 * S.std() / std::sqrt( (double) S.size() );
+		M.stable = S.size() >= MICROBENCH_MIN_SAMPLES && M.ci <= target * S.mean();
+
+		if ( M.stable || total.stop() > MICROBENCH_POINT_TIME ) break;
+	}
+
+	M.samples = S.size();
+	M.ns = S.mean();
+	return M;
+}
+
+
+
+/**
+ * [fit_slope Least-squares slope of log(time) against log(n), and its standard error.]
+ */
+void fit_slope( const std::vector<Measure>& M, double& slope, double& se )
+{
+	const unsigned m = M.size();
+	double mx = 0.0, my = 0.0, sxx = 0.0, sxy = 0.0, rss = 0.0;
+
+	slope = se = 0.0;
+	if ( m < 2 ) return;
+
+	for ( unsigned k = 0; k < m; ++k ) { mx += std::log(M[k].n); my += std::log(M[k].ns); }
+	mx /= m; my /= m;
+
+	for ( unsigned k = 0; k < m; ++k )
+	{
+		const double x = std::log(M[k].n) - mx, y = std::log(M[k].ns) - my;
+		sxx += x*x; sxy += x*y;
+	}
+	slope = sxy / sxx;
+
+	for ( unsigned k = 0; k < m; ++k )
+	{
+		const double r = std::log(M[k].ns) - my - slope*(std::log(M[k].n) - mx);
+		rss += r*r;
+	}
+	if ( m > 2 ) se = std::sqrt( rss / (m-2) / sxx );
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+int main( int argc, char **argv )
+{
+	// Options
+	unsigned first = 6, last = 20, step = 2;
+	double target = MICROBENCH_TARGET;
+	std::string filter;
+
+	for ( int i = 1; i+1 < argc; i += 2 )
+	{
+		if ( !strcmp(argv[i],"--sizes") ) 
+		{
+			if ( sscanf( argv[i+1], "%u:%u:%u", &first, &last, &step ) < 2 || first < 2 || !step ) 
+				{ printf("Invalid sizes %s (A:B[:S]).\n", argv[i+1]); return 1; }
+		}
+		else if ( !strcmp(argv[i],"--kernels") ) filter = argv[i+1];
+		else if ( !strcmp(argv[i],"--target") ) target = atof( argv[i+1] );
+		else { printf("Usage: %s [--sizes A:B[:S]] [--kernels SUBSTRING] [--target CI]\n", argv[0]); return 1; }
+	}
+
+	// Inputs of the kernels
+	std::vector<unsigned> d;
+	std::vector<bool> G;
+	Forest forest;
+	Jonathan jonathan;
+	Angelo angelo;
+	SMCSIndexer indexer;
+	unsigned tree = 0;
+
+	BulkRandom::seed( 42 );
+
+	// Hot paths
+	std::vector<Kernel> kernels;
+
+	Kernel k1 = { "generate_graphic_sequence", 1u << 30,
+		[&]( const unsigned& n ){ d.resize(n); },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) { generate_graphic_sequence(d); sink += d[0]; } 
+			return reps; } };
+	kernels.push_back(k1);
+
+	Kernel k2 = { "graphic_sequence_test", 1u << 30,
+		[&]( const unsigned& n ){ d.resize(n); generate_graphic_sequence(d); },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) sink += graphic_sequence_test(d); 
+			return reps; } };
+	kernels.push_back(k2);
+
+	Kernel k3 = { "CUR_Graph::generate", 1u << 30,
+		[&]( const unsigned& n ){ d.resize(n); generate_graphic_sequence(d); G.resize( n*(n+1) >> 1 ); },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) 
+			{ 
+				std::fill( G.begin(), G.end(), false ); 
+				generate_cur_graph(d,G); sink += G[1]; 
+			} 
+			return reps; } };
+	kernels.push_back(k3);
+
+	Kernel k4 = { "Forest::postgen_set", 1u << 30,
+		[&]( const unsigned& n ){ 
+			forest.generate(n); G.assign( n*(n+1) >> 1, false );
+			for ( unsigned t = 0; t < n; ++t )
+			for ( unsigned e = forest.get_strides()[t]; e < forest.get_strides()[t+1]; ++e )
+				G[ indexer.sub2ind( n, t, forest.get_neighbors()[e] ) ] = true; },
+		[&]( const unsigned& reps ){ 
+			const unsigned n = forest.size();
+			for ( unsigned r = 0; r < reps; ++r ) sink += forest.assign(n,G); 
+			return reps; } };
+	kernels.push_back(k4);
+
+	Kernel k5 = { "Forest::random_neighbor", 1u << 30,
+		[&]( const unsigned& n ){ forest.generate(n); tree = 0; },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) tree = forest.random_neighbor(tree); 
+			sink += tree; return reps; } };
+	kernels.push_back(k5);
+
+	Kernel k6 = { "Jonathan::shoot", 1u << 30,
+		[&]( const unsigned& n ){ forest.generate(n); jonathan.set_forest(forest); },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) 
+			{ 
+				const int s = jonathan.shoot(); 
+				if ( s < 0 ) jonathan.restart(); else sink += s; 
+			}
+			return reps; } };
+	kernels.push_back(k6);
+
+	// Angelo without a plan cache runs bfs in set_forest
+	Kernel k7 = { "Angelo::bfs", 21,
+		[&]( const unsigned& n ){ forest.generate(n); },
+		[&]( const unsigned& reps ){ 
+			for ( unsigned r = 0; r < reps; ++r ) sink += angelo.set_forest(forest); 
+			return reps; } };
+	kernels.push_back(k7);
+
+	// One operation is the conversion of one index
+	Kernel k8 = { "SMCSIndexer::ind2sub", 1u << 30,
+		[&]( const unsigned& n ){ tree = n; },
+		[&]( const unsigned& reps ){ 
+			const unsigned n = tree, m = n*(n+1) >> 1; unsigned i, j;
+			for ( unsigned r = 0; r < reps; ++r ) 
+			for ( unsigned index = 0; index < m; ++index ) 
+				{ indexer.ind2sub(n,index,i,j); sink += i^j; }
+			return reps*m; } };
+	kernels.push_back(k8);
+
+	// Run all kernels on all sizes
+	std::vector<const Kernel*> selected;
+	std::vector< std::vector<Measure> > results;
+	std::vector<unsigned> sizes;
+
+	for ( unsigned n = first; n <= last; n += step ) sizes.push_back(n);
+
+	for ( auto K = kernels.cbegin(); K != kernels.cend(); ++K ) 
+	{
+		if ( !filter.empty() && !strstr( K->name, filter.c_str() ) ) continue;
+
+		printf("== %s ==\n", K->name);
+		printf("%6s %14s %12s %12s %8s\n", "n", "ns/op", "+-95%", "Mops/s", "samples");
+
+		std::vector<Measure> M;
+		for ( auto n = sizes.cbegin(); n != sizes.cend() && *n <= K->max_n; ++n )
+		{
+			M.push_back( measure( *K, *n, target ) );
+			const Measure& m = M.back();
+			printf("%6u %14.3f %12.3f %12.4f %8u%s\n", m.n, m.ns, m.ci, 1e3/m.ns, m.samples, m.stable ? "" : " (unstable)");
+		}
+
+		double slope, se; fit_slope( M, slope, se );
+		printf("Empirical complexity: O(n^%.2f), std error %.2f\n\n", slope, se);
+
+		selected.push_back( &*K );
+		results.push_back(M);
+	}
+
+	// Time per call of each kernel at each size
+	printf("== Time per operation (us) ==\n%6s", "n");
+	for ( unsigned k = 0; k < selected.size(); ++k ) printf(" %12.12s", selected[k]->name);
+	printf("\n");
+
+	for ( unsigned s = 0; s < sizes.size(); ++s )
+	{
+		printf("%6u", sizes[s]);
+		for ( unsigned k = 0; k < selected.size(); ++k ) 
+			if ( s < results[k].size() ) printf(" %12.4f", results[k][s].ns / 1e3); else printf(" %12s", "-");
+		printf("\n");
+	}
+}
@@ -0,0 +1,256 @@
+#include "perf_counters.h"
+
+//=============================================
+// @filename     perf_counters.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [PerfCounts::clear Reset all counts.]
+ */
+void PerfCounts::clear()
+{
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) { value[e] = 0; available[e] = false; }
+	ops = 0;
+}
+
+
+
+/**
+ * [PerfCounts::merge Add the counts of other sections.]
+ * @param other [The other counts.]
+ */
+void PerfCounts::merge( const PerfCounts& other )
+{
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) 
+	{
+		value[e] += other.value[e];
+		available[e] = available[e] || other.available[e];
+	}
+	ops += other.ops;
+}
+
+
+
+/**
+ * [PerfCounts::print Display counts per operation on stdout.]
+ * @param phase [Name of the phase.]
+ * @param op    [Name of an operation of the phase.]
+ */
+void PerfCounts::print( const char *phase, const char *op ) const
+{
+	static const char *names[PERF_N_EVENTS] = { "cycles", "instr", "L1D-miss", "LLC-miss", "br-miss" };
+
+	if ( !any() ) return;
+
+	printf("\t- %s (per %s):", phase, op);
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e )
+		if ( available[e] ) printf(" %s=%.1f", names[e], double(value[e]) / ops);
+		else printf(" %s=n/a", names[e]);
+
+	if ( available[PERF_CYCLES] && available[PERF_INSTRUCTIONS] && value[PERF_CYCLES] )
+		printf(" IPC=%.2f", double(value[PERF_INSTRUCTIONS]) / value[PERF_CYCLES]);
+	printf("\n");
+}
+
+
+
+/**
+ * [PerfCounts::save Write the number of operations, then each value and availability.]
+ * @param f [Output file.]
+ */
+void PerfCounts::save( FILE *f ) const
+{
+	fprintf( f, "%llu", (unsigned long long) ops );
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) 
+		fprintf( f, " %llu %d", (unsigned long long) value[e], (int) available[e] );
+}
+
+
+
+/**
+ * [PerfCounts::load Read counts written by save.]
+ * @param  f [Input file.]
+ * @return   [False if the input is invalid.]
+ */
+bool PerfCounts::load( FILE *f )
+{
+	unsigned long long x; int a;
+	if ( fscanf( f, "%llu", &x ) != 1 ) return false;
+
+	ops = x;
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e )
+	{
+		if ( fscanf( f, "%llu %d", &x, &a ) != 2 ) return false;
+		value[e] = x; available[e] = a != 0;
+	}
+
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [PerfCounters::PerfCounters Nothing is opened until open() is called.]
+ */
+PerfCounters::PerfCounters()
+	: leader(-1), n_open(0)
+{
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) { fd[e] = index[e] = -1; begin[e] = 0.0; }
+}
+
+
+
+/**
+ * [PerfCounters::open Open the hardware counters of the calling thread.]
+ * @return [False if no counter could be opened.]
+ */
+bool PerfCounters::open()
+{
+	close();
+
+#ifdef __linux__
+
+	const uint32_t types[PERF_N_EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, 
+		PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+	const uint64_t configs[PERF_N_EVENTS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e )
+	{
+		struct perf_event_attr attr;
+		memset( &attr, 0, sizeof(attr) );
+
+		attr.size           = sizeof(attr);
+		attr.type           = types[e];
+		attr.config         = configs[e];
+		attr.disabled       = leader < 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+		attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// Events that are not supported are skipped
+		fd[e] = syscall( __NR_perf_event_open, &attr, 0, -1, leader, 0 );
+		if ( fd[e] < 0 ) continue;
+
+		if ( leader < 0 ) leader = fd[e];
+		index[e] = n_open++;
+	}
+
+	if ( leader < 0 ) return false;
+
+	ioctl( leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+	ioctl( leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+	return true;
+
+#else
+	return false;
+#endif
+}
+
+
+
+/**
+ * [PerfCounters::close Close all counters.]
+ */
+void PerfCounters::close()
+{
+#ifdef __linux__
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) if ( fd[e] >= 0 ) ::close( fd[e] );
+#endif
+
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) fd[e] = index[e] = -1;
+	leader = -1; n_open = 0;
+}
+
+
+
+/**
+ * [PerfCounters::read Read the values of all events since open(), scaled by the fraction 
+ * of time the group was actually counting.]
+ * @param  values [Output values (negative for events that are not counted).]
+ * @return        [False if the group could not be read or never ran.]
+ */
+bool PerfCounters::read( double *values )
+{
+#ifdef __linux__
+
+	uint64_t buffer[ 3 + PERF_N_EVENTS ];
+	if ( ::read( leader, buffer, sizeof(buffer) ) < (ssize_t) ((3 + n_open)*sizeof(uint64_t)) ) return false;
+
+	// Layout: nr, time_enabled, time_running, values...
+	const double enabled = buffer[1], running = buffer[2];
+	if ( running <= 0.0 ) return false;
+
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e )
+		values[e] = index[e] < 0 ? -1.0 : buffer[ 3 + index[e] ] * (enabled / running);
+	return true;
+
+#else
+	(void) values;
+	return false;
+#endif
+}
+
+
+
+/**
+ * [PerfCounters::start Begin a counted section.]
+ */
+void PerfCounters::start()
+{
+	if ( leader >= 0 && !read(begin) ) 
+		for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) begin[e] = -1.0;
+}
+
+
+
+/**
+ * [PerfCounters::stop End a counted section, and add its counts.]
+ * @param counts [Counts of the phase.]
+ * @param ops    [Number of operations done in the section.]
+ */
+void PerfCounters::stop( PerfCounts& counts, const uint64_t& ops )
+{
+	double end[PERF_N_EVENTS];
+	if ( leader < 0 || !read(end) ) return;
+
+	for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) 
+		if ( index[e] >= 0 && begin[e] >= 0.0 && end[e] >= begin[e] )
+		{
+			counts.value[e] += static_cast<uint64_t>( end[e] - begin[e] + 0.5 );
+			counts.available[e] = true;
+		}
+
+	counts.ops += ops;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
@@ -0,0 +1,108 @@
+#ifndef __PERF_COUNTERS__
+#define __PERF_COUNTERS__
+
+//=============================================
+// @filename     perf_counters.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdio>
+#include <cstdint>
+
+#define PERF_N_EVENTS 5
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Hardware events counted in each phase.
+ */
+enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES };
+
+
+
+/**
+ * Events counted in one phase, summed over all the sections of this phase.
+ * Counts are scaled when the kernel multiplexed the counters; events that could not 
+ * be counted are flagged as unavailable. ops is the number of operations (shots, jumps,
+ * calls) done in the counted sections, to normalize the counts.
+ */
+struct PerfCounts
+{
+	uint64_t value[PERF_N_EVENTS];
+	bool available[PERF_N_EVENTS];
+	uint64_t ops;
+
+	PerfCounts() { clear(); }
+
+	void clear();
+	void merge( const PerfCounts& other );
+
+	// Has anything been counted?
+	inline bool any() const 
+	{ 
+		for ( unsigned e = 0; e < PERF_N_EVENTS; ++e ) if ( available[e] ) return ops > 0;
+		return false;
+	}
+
+	// Display counts per operation
+	void print( const char *phase, const char *op ) const;
+
+	// Text serialization (on a single line, without newline)
+	void save( FILE *f ) const;
+	bool load( FILE *f );
+};
+
+
+
+/**
+ * Hardware counters of the calling thread, using Linux' perf_event_open.
+ * All events are opened in a single group, so that they are read with one system call.
+ * Counting is opt-in: open() returns false when counters are unavailable (other OS, 
+ * restricted perf_event_paranoid, virtual machines...), in which case start() and stop()
+ * do nothing.
+ */
+class PerfCounters
+{
+public:
+
+	// Ctor/dtor
+	PerfCounters();
+	~PerfCounters() { close(); }
+
+	// Open the counters for the calling thread
+	bool open();
+	void close();
+
+	// Are any counters open?
+	inline bool available() const { return leader >= 0; }
+
+	// Count the events of a section, and add them to counts
+	void start();
+	void stop( PerfCounts& counts, const uint64_t& ops = 1 );
+
+private:
+
+	// Non-copyable
+	PerfCounters( const PerfCounters& );
+	PerfCounters& operator=( const PerfCounters& );
+
+	// Read scaled values of all events
+	bool read( double *values );
+
+	// Members
+	// 
+	int leader, fd[PERF_N_EVENTS], index[PERF_N_EVENTS];
+	unsigned n_open;
+	double begin[PERF_N_EVENTS];
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "statistics.h"
+
+//=============================================
+// @filename     statistics.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [LogHistogram::clear Remove all values (memory is kept).]
+ */
+void LogHistogram::clear()
+{
+	counts.clear();
+	total = n_zeros = 0;
+	offset = 0;
+}
+
+
+
+/**
+ * [LogHistogram::bucket Index of the bucket of a positive value.]
+ * @param  x [Positive value.]
+ * @return   [Bucket index (octave * 2^HISTOGRAM_SUB_BITS + sub-bucket).]
+ */
+int LogHistogram::bucket( const double& x )
+{
+	int e; const double m = std::frexp( x, &e ); // m in [0.5,1)
+	const int sub = static_cast<int>( (2*m - 1) * (1 << HISTOGRAM_SUB_BITS) );
+
+	return e * (1 << HISTOGRAM_SUB_BITS) + sub;
+}
+
+
+
+/**
+ * [LogHistogram::value Middle of a bucket.]
+ * @param  b [Bucket index.]
+ * @return   [Representative value.]
+ */
+double LogHistogram::value( const int& b )
+{
+	const int S = 1 << HISTOGRAM_SUB_BITS;
+	const int e = b >= 0 ? b / S : -((S-1-b) / S);
+	const int sub = b - e*S;
+
+	return std::ldexp( 0.5 * (1.0 + (sub + 0.5) / S), e );
+}
+
+
+
+/**
+ * [LogHistogram::lower Lower bound of a bucket.]
+ * @param  b [Bucket index.]
+ * @return   [Smallest value of the bucket.]
+ */
+double LogHistogram::lower( const int& b )
+{
+	const int S = 1 << HISTOGRAM_SUB_BITS;
+	const int e = b >= 0 ? b / S : -((S-1-b) / S);
+	const int sub = b - e*S;
+
+	return std::ldexp( 0.5 * (1.0 + double(sub) / S), e );
+}
+
+
+
+/**
+ * [LogHistogram::add Add a value.]
+ * @param x     [The value.]
+ * @param count [Number of times it is added.]
+ */
+void LogHistogram::add( const double& x, const uint64_t& count )
+{
+	total += count;
+	if ( !(x > 0.0) ) { n_zeros += count; return; }
+
+	const int b = bucket(x);
+
+	// Extend the range of buckets
+	if ( counts.empty() ) { offset = b; counts.assign( 1, 0 ); }
+	else if ( b < offset ) { counts.insert( counts.begin(), offset-b, 0 ); offset = b; }
+	else if ( b >= offset + (int) counts.size() ) counts.resize( b-offset+1, 0 );
+
+	counts[ b-offset ] += count;
+}
+
+
+
+/**
+ * [LogHistogram::merge Add all values of another histogram.]
+ * @param other [The other histogram.]
+ */
+void LogHistogram::merge( const LogHistogram& other )
+{
+	n_zeros += other.n_zeros; 
+	total   += other.n_zeros;
+
+	for ( unsigned k = 0; k < other.counts.size(); ++k ) if ( other.counts[k] ) 
+		add( value(other.offset + k), other.counts[k] );
+}
+
+
+
+/**
+ * [LogHistogram::quantile Approximate quantile.]
+ * @param  q        [Probability in [0,1].]
+ * @param  integral [The values are integers.]
+ * @return          [Middle of the bucket containing the q-quantile (smallest integer of the 
+ *                   bucket if integral), 0 if empty.]
+ */
+double LogHistogram::quantile( const double& q, const bool& integral ) const
+{
+	if ( total == 0 ) return 0.0;
+
+	// Rank of the quantile (1-based)
+	uint64_t rank = static_cast<uint64_t>( std::ceil( q * total ) );
+	if ( rank < 1 ) rank = 1;
+
+	if ( rank <= n_zeros ) return 0.0;
+	rank -= n_zeros;
+
+	unsigned k = 0;
+	for ( ; k+1 < counts.size() && rank > counts[k]; ++k ) rank -= counts[k];
+
+	return integral ? std::ceil( lower(offset + k) ) : value(offset + k);
+}
+
+
+
+/**
+ * [LogHistogram::save Write the histogram: total, zeros, first bucket, number of buckets, counts.]
+ * @param f [Output file.]
+ */
+void LogHistogram::save( FILE *f ) const
+{
+	fprintf( f, "%llu %llu %d %u", (unsigned long long) total, (unsigned long long) n_zeros, 
+		offset, (unsigned) counts.size() );
+	for ( auto c = counts.cbegin(); c != counts.cend(); ++c ) 
+		fprintf( f, " %llu", (unsigned long long) *c );
+}
+
+
+
+/**
+ * [LogHistogram::load Read a histogram written by save.]
+ * @param  f [Input file.]
+ * @return   [False if the input is invalid.]
+ */
+bool LogHistogram::load( FILE *f )
+{
+	unsigned long long t, z, c; unsigned n;
+	if ( fscanf( f, "%llu %llu %d %u", &t, &z, &offset, &n ) != 4 ) return false;
+
+	total = t; n_zeros = z;
+	counts.resize(n);
+	for ( unsigned k = 0; k < n; ++k ) 
+		if ( fscanf( f, "%llu", &c ) != 1 ) return false; else counts[k] = c;
+
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [StreamingStatistics::clear Remove all values.]
+ */
+void StreamingStatistics::clear()
+{
+	n  = 0;
+	mu = m2 = 0.0;
+	lo = std::numeric_limits<double>::max();
+	hi = -std::numeric_limits<double>::max();
+	histogram.clear();
+}
+
+
+
+/**
+ * [StreamingStatistics::add Add a value (Welford's update).]
+ * @param x [The value.]
+ */
+void StreamingStatistics::add( const double& x )
+{
+	++n;
+	const double delta = x - mu;
+	mu += delta / n;
+	m2 += delta * (x - mu);
+
+	if ( x < lo ) lo = x;
+	if ( x > hi ) hi = x;
+
+	histogram.add(x);
+}
+
+
+
+/**
+ * [StreamingStatistics::merge Merge another accumulator (Chan et al. pairwise update).]
+ * @param other [The other accumulator.]
+ */
+void StreamingStatistics::merge( const StreamingStatistics& other )
+{
+	if ( other.n == 0 ) return;
+	if ( n == 0 ) { *this = other; return; }
+
+	const double N = static_cast<double>(n + other.n);
+	const double delta = other.mu - mu;
+
+	mu += delta * other.n / N;
+	m2 += other.m2 + delta*delta * n * other.n / N;
+	n  += other.n;
+
+	lo = std::min( lo, other.lo );
+	hi = std::max( hi, other.hi );
+
+	histogram.merge( other.histogram );
+}
+
+
+
+/**
+ * [StreamingStatistics::save Write the accumulator: count, mean, m2, min, max, histogram.]
+ * @param f [Output file.]
+ */
+void StreamingStatistics::save( FILE *f ) const
+{
+	fprintf( f, "%llu %a %a %a %a ", (unsigned long long) n, mu, m2, lo, hi );
+	histogram.save(f);
+}
+
+
+
+/**
+ * [StreamingStatistics::load Read an accumulator written by save.]
+ * @param  f [Input file.]
+ * @return   [False if the input is invalid.]
+ */
+bool StreamingStatistics::load( FILE *f )
+{
+	unsigned long long count;
+	if ( fscanf( f, "%llu %la %la %la %la", &count, &mu, &m2, &lo, &hi ) != 5 ) return false;
+
+	n = count;
+	return histogram.load(f);
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
@@ -0,0 +1,137 @@
+#ifndef __STATISTICS__
+#define __STATISTICS__
+
+//=============================================
+// @filename     statistics.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#define HISTOGRAM_SUB_BITS 4
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Mergeable log-scale histogram, in the spirit of HDR histograms.
+ *
+ * Each octave [2^e, 2^(e+1)) is split into 2^HISTOGRAM_SUB_BITS buckets of equal width,
+ * so quantiles are known within a relative error of 2^-(HISTOGRAM_SUB_BITS+1). Only the
+ * range of buckets between the smallest and the largest value is stored, which keeps
+ * histograms small for values of similar magnitudes. Non-positive values are counted 
+ * apart, as zeros.
+ *
+ * Quantiles of real values are the middles of their buckets. Quantiles of integers (e.g.
+ * shot counts) are the smallest integers of their buckets, which are exact up to 
+ * 2^(HISTOGRAM_SUB_BITS+1), where each integer has its own bucket.
+ */
+class LogHistogram
+{
+public:
+
+	// Ctor
+	LogHistogram() { clear(); }
+
+	// Remove all values
+	void clear();
+
+	// Add a value, or merge another histogram
+	void add( const double& x, const uint64_t& count = 1 );
+	void merge( const LogHistogram& other );
+
+	// Number of values
+	inline uint64_t size() const { return total; }
+
+	// Approximate q-quantile (q in [0,1]), of integers if integral is set
+	double quantile( const double& q, const bool& integral = false ) const;
+
+	// Access to the buckets, e.g. for serialization
+	inline int first_bucket() const { return offset; }
+	inline uint64_t zeros() const { return n_zeros; }
+	inline const std::vector<uint64_t>& buckets() const { return counts; }
+
+	// Exact text serialization (on a single line, without newline)
+	void save( FILE *f ) const;
+	bool load( FILE *f );
+
+private:
+
+	// Bucket of a positive value, representative value and lower bound of a bucket
+	static int bucket( const double& x );
+	static double value( const int& b );
+	static double lower( const int& b );
+
+	// Members
+	// 
+	std::vector<uint64_t> counts;
+	uint64_t total, n_zeros;
+	int offset;
+};
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Online accumulator of a sample: count, mean and variance (Welford), min, max and 
+ * approximate quantiles. Two accumulators can be merged (Chan et al.), e.g. across
+ * threads or runs; merging in the same order always gives the same result.
+ */
+class StreamingStatistics
+{
+public:
+
+	// Ctor
+	StreamingStatistics() { clear(); }
+
+	// Remove all values
+	void clear();
+
+	// Add a value, or merge another accumulator
+	void add( const double& x );
+	void merge( const StreamingStatistics& other );
+
+	// Statistics
+	inline uint64_t size() const { return n; }
+	inline double mean() const { return mu; }
+	inline double sum() const { return mu*n; }
+	inline double variance() const { return n > 1 ? m2/(n-1) : 0.0; }
+	inline double std() const { return std::sqrt(variance()); }
+	inline double min() const { return lo; }
+	inline double max() const { return hi; }
+
+	inline double quantile( const double& q, const bool& integral = false ) const 
+		{ return histogram.quantile( q, integral ); }
+	inline const LogHistogram& get_histogram() const { return histogram; }
+
+	// Exact text serialization (floats in hexadecimal, on a single line, without newline)
+	void save( FILE *f ) const;
+	bool load( FILE *f );
+
+private:
+
+	// Members
+	// 
+	uint64_t n;
+	double mu, m2, lo, hi;
+	LogHistogram histogram;
+};
+
+#endif
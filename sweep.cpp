@@ -0,0 +1,591 @@
+#include "sweep.h"
+
+//=============================================
+// @filename     sweep.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Recursive descent parser of size expressions.
+ * expr = term {(+|-) term}, term = power {(*|/) power}, power = atom [^ power],
+ * atom = number | n | ( expr ) | - atom
+ */
+class SizeExpression
+{
+public:
+
+	SizeExpression( const char *expr, const double& n ): c(expr), n(n), ok(true) {}
+
+	bool evaluate( double& value )
+	{
+		value = expr(); skip();
+		return ok && *c == '\0';
+	}
+
+private:
+
+	inline void skip() { while ( *c == ' ' ) ++c; }
+
+	double expr()
+	{
+		double v = term();
+		for ( skip(); *c == '+' || *c == '-'; skip() )
+			v = *c++ == '+' ? v + term() : v - term();
+		return v;
+	}
+
+	double term()
+	{
+		double v = power();
+		for ( skip(); *c == '*' || *c == '/'; skip() )
+			v = *c++ == '*' ? v * power() : v / power();
+		return v;
+	}
+
+	double power()
+	{
+		const double v = atom(); skip();
+		if ( *c != '^' ) return v;
+		++c; return std::pow( v, power() );
+	}
+
+	double atom()
+	{
+		skip();
+		if ( *c == '-' ) { ++c; return -atom(); }
+		if ( *c == 'n' ) { ++c; return n; }
+		if ( *c == '(' ) 
+		{ 
+			++c; const double v = expr(); skip();
+			if ( *c++ != ')' ) ok = false;
+			return v;
+		}
+
+		char *end; const double v = std::strtod( c, &end );
+		if ( end == c ) ok = false;
+		c = end; return v;
+	}
+
+	const char *c;
+	const double n;
+	bool ok;
+};
+
+
+
+/**
+ * [evaluate_size_expression Evaluate an expression of the number of trees.]
+ * @param  expr  [The expression.]
+ * @param  n     [Number of trees.]
+ * @param  value [Output value.]
+ * @return       [False if the expression is invalid.]
+ */
+bool evaluate_size_expression( const char* expr, const double& n, double& value )
+{
+	return SizeExpression( expr, n ).evaluate( value );
+}
+
+
+
+/**
+ * [generator_name Name of a random graph model.]
+ */
+const char* generator_name( const ForestGenerator& generator )
+{
+	switch ( generator )
+	{
+		case TREE_GENERATOR: return "tree";
+		default:             return "cur";
+	}
+}
+
+
+
+/**
+ * [jumps_name Name of a law of jumps.]
+ */
+const char* jumps_name( const JumpModel& jumps )
+{
+	switch ( jumps )
+	{
+		case RANDOM_JUMPS: return "random";
+		case DEGREE_JUMPS: return "degree";
+		default:           return "uniform";
+	}
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [SweepSpec::defaults The sweep that used to be hard-coded in main.]
+ */
+void SweepSpec::defaults()
+{
+	sizes.clear();
+	for ( unsigned n = 6; n <= 21; ++n ) sizes.push_back(n);
+
+	instances = "n^2";
+	trials    = "n";
+	generator = CUR_GENERATOR;
+	jumps     = UNIFORM_JUMPS;
+
+	hunters.clear();
+	hunters.push_back("Angelo");
+	hunters.push_back("Jonathan");
+
+	has_seed = false; seed = 0;
+	max_shots = 10000; max_seconds = 10.0; threads = 0;
+	alpha = SWEEP_ALPHA; analyses = true; counters = stratified = false;
+
+	precision.shots = precision.success = precision.time = 0.0;
+	precision.max_instances = 0;
+
+	json_file.clear(); csv_file.clear(); baseline_file.clear(); checkpoint_file.clear(); plan_cache_file.clear();
+	checkpoint_period = BENCHMARK_CHECKPOINT_PERIOD;
+
+	shard_index = 0; shard_count = 1;
+	partial_file.clear(); merge_files.clear();
+}
+
+
+
+/**
+ * [SweepSpec::usage Print usage on stdout.]
+ * @param program [Name of the executable.]
+ */
+void SweepSpec::usage( const char *program )
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --sizes A:B[:S] | A,B,..   Numbers of trees, at most %d with Angelo (default 6:21)\n", ANGELO_MAXTREES);
+	printf("  --instances EXPR           Forests per size, expression of n (default n^2)\n");
+	printf("  --trials EXPR              Trials per forest, expression of n (default n)\n");
+	printf("  --generator cur|tree       Random graph model of the forests (default cur)\n");
+	printf("  --jumps uniform|random|degree  Law of Bob's jumps (default uniform)\n");
+	printf("  --hunters NAME,NAME        Hunters to run (default Angelo,Jonathan)\n");
+	printf("  --seed S                   Seed of the benchmark (default random)\n");
+	printf("  --shots N                  Max shots per trial, 0 for unlimited (default 10000)\n");
+	printf("  --seconds T                Max seconds per hunt, 0 for unlimited (default 10)\n");
+	printf("  --threads K                Number of threads, 0 for all cores (default 0)\n");
+	printf("  --json FILE                Write results as JSON\n");
+	printf("  --csv FILE                 Write results as CSV\n");
+	printf("  --baseline FILE            Flag significant increases w.r.t. a previous CSV\n");
+	printf("  --alpha A                  Level of the regression tests (default %g)\n", SWEEP_ALPHA);
+	printf("  --no-analysis              Skip plan verification, evaluation and comparison\n");
+	printf("  --counters                 Count hardware events in each phase (Linux only)\n");
+	printf("  --ci-shots R               Add instances until the 95%% CI on shots is within R*mean\n");
+	printf("  --ci-time R                Add instances until the 95%% CI on hunt time is within R*mean\n");
+	printf("  --ci-success A             Add instances until the 95%% CI on success ratio is within A\n");
+	printf("  --max-instances N          Hard cap on the instances of each size (default 0, none)\n");
+	printf("  --stratified               Start the trials of a forest on all trees in turn\n");
+	printf("  --checkpoint FILE          Save progress in FILE, and resume from it if it exists\n");
+	printf("  --every T                  Seconds between checkpoints (default %g)\n", BENCHMARK_CHECKPOINT_PERIOD);
+	printf("  --shard I/K                Run the I-th of K shards (0-based) of the sweep\n");
+	printf("  --partial FILE             Partial results of the shard (default shard_I_of_K.txt)\n");
+	printf("  --merge FILE,FILE          Merge the partial files of all shards, run with the same options\n");
+	printf("  --plan-cache FILE          Load Angelo's plans from FILE and save them back (default none)\n");
+}
+
+
+
+/**
+ * [split Split a string on a separator.]
+ */
+static std::vector<std::string> split( const std::string& s, const char& sep )
+{
+	std::vector<std::string> parts;
+	for ( std::string::size_type a = 0, b; a <= s.size(); a = b+1 )
+	{
+		if ( (b = s.find(sep,a)) == std::string::npos ) b = s.size();
+		parts.push_back( s.substr(a,b-a) );
+	}
+	return parts;
+}
+
+
+
+/**
+ * [parse_unsigned Strict conversion of a string to an unsigned integer.]
+ */
+static bool parse_unsigned( const std::string& s, unsigned long long& value )
+{
+	char *end; 
+	if ( s.empty() || s[0] == '-' ) return false;
+	value = std::strtoull( s.c_str(), &end, 0 );
+	return *end == '\0';
+}
+
+
+
+/**
+ * [SweepSpec::parse Parse command-line arguments.]
+ * @param  argc [Number of arguments.]
+ * @param  argv [Arguments.]
+ * @return      [False if the arguments are invalid, or if help was requested.]
+ */
+bool SweepSpec::parse( int argc, char **argv )
+{
+	defaults();
+
+	for ( int i = 1; i < argc; ++i )
+	{
+		const std::string opt = argv[i];
+
+		// Flags
+		if ( opt == "--help" || opt == "-h" ) { usage(argv[0]); return false; }
+		if ( opt == "--no-analysis" ) { analyses = false; continue; }
+		if ( opt == "--counters" ) { counters = true; continue; }
+		if ( opt == "--stratified" ) { stratified = true; continue; }
+
+		// Options with a value
+		if ( i+1 >= argc ) { printf("Missing value for %s.\n", opt.c_str()); return false; }
+		const std::string val = argv[++i];
+
+		unsigned long long u = 0; char *end; bool ok = true;
+
+		if ( opt == "--sizes" )
+		{
+			sizes.clear();
+			std::vector<std::string> range = split(val,':');
+			unsigned long long a, b, s = 1;
+
+			if ( range.size() == 2 || range.size() == 3 )
+			{
+				ok = parse_unsigned(range[0],a) && parse_unsigned(range[1],b) && 
+					(range.size() == 2 || parse_unsigned(range[2],s)) && s > 0 && a <= b;
+				for ( ; ok && a <= b; a += s ) sizes.push_back(a);
+			}
+			else
+			{
+				std::vector<std::string> list = split(val,',');
+				for ( auto it = list.begin(); ok && it != list.end(); ++it )
+					if ( (ok = parse_unsigned(*it,a)) ) sizes.push_back(a);
+			}
+
+			for ( auto it = sizes.begin(); ok && it != sizes.end(); ++it ) ok = *it >= 2;
+		}
+		else if ( opt == "--instances" ) instances = val;
+		else if ( opt == "--trials" )    trials = val;
+		else if ( opt == "--generator" )
+		{
+			if ( val == "cur" ) generator = CUR_GENERATOR;
+			else if ( val == "tree" ) generator = TREE_GENERATOR;
+			else ok = false;
+		}
+		else if ( opt == "--jumps" )
+		{
+			if ( val == "uniform" ) jumps = UNIFORM_JUMPS;
+			else if ( val == "random" ) jumps = RANDOM_JUMPS;
+			else if ( val == "degree" ) jumps = DEGREE_JUMPS;
+			else ok = false;
+		}
+		else if ( opt == "--hunters" )  hunters = split(val,',');
+		else if ( opt == "--seed" )     { ok = parse_unsigned(val,u); seed = u; has_seed = true; }
+		else if ( opt == "--shots" )    { ok = parse_unsigned(val,u); max_shots = u; }
+		else if ( opt == "--threads" )  { ok = parse_unsigned(val,u); threads = u; }
+		else if ( opt == "--seconds" )  { max_seconds = std::strtod(val.c_str(),&end); ok = *end == '\0' && max_seconds >= 0.0; }
+		else if ( opt == "--alpha" )    { alpha = std::strtod(val.c_str(),&end); ok = *end == '\0' && alpha > 0.0 && alpha < 0.5; }
+		else if ( opt == "--ci-shots" )   { precision.shots = std::strtod(val.c_str(),&end); ok = *end == '\0' && precision.shots >= 0.0; }
+		else if ( opt == "--ci-time" )    { precision.time = std::strtod(val.c_str(),&end); ok = *end == '\0' && precision.time >= 0.0; }
+		else if ( opt == "--ci-success" ) { precision.success = std::strtod(val.c_str(),&end); ok = *end == '\0' && precision.success >= 0.0; }
+		else if ( opt == "--max-instances" ) { ok = parse_unsigned(val,u); precision.max_instances = u; }
+		else if ( opt == "--checkpoint" ) checkpoint_file = val;
+		else if ( opt == "--shard" )    ok = sscanf( val.c_str(), "%u/%u", &shard_index, &shard_count ) == 2 && shard_index < shard_count;
+		else if ( opt == "--partial" )  partial_file = val;
+		else if ( opt == "--merge" )    merge_files = split(val,',');
+		else if ( opt == "--every" )    { checkpoint_period = std::strtod(val.c_str(),&end); ok = *end == '\0' && checkpoint_period >= 0.0; }
+		else if ( opt == "--json" )     json_file = val;
+		else if ( opt == "--csv" )      csv_file = val;
+		else if ( opt == "--baseline" ) baseline_file = val;
+		else if ( opt == "--plan-cache" ) plan_cache_file = val;
+		else { printf("Unknown option %s.\n", opt.c_str()); usage(argv[0]); return false; }
+
+		if ( !ok ) { printf("Invalid value for %s: %s\n", opt.c_str(), val.c_str()); return false; }
+	}
+
+	// Shards need the same seed to generate the same forests
+	if ( shard_count > 1 )
+	{
+		if ( !has_seed ) { printf("Shards need an explicit --seed.\n"); return false; }
+		if ( partial_file.empty() ) 
+		{
+			char name[64]; snprintf( name, sizeof(name), "shard_%u_of_%u.txt", shard_index, shard_count );
+			partial_file = name;
+		}
+	}
+
+	// Angelo explores the subsets of the trees, which bounds the size of his forests
+	if ( std::find( hunters.begin(), hunters.end(), "Angelo" ) != hunters.end() )
+		for ( auto it = sizes.begin(); it != sizes.end(); ++it ) if ( *it > ANGELO_MAXTREES )
+		{
+			printf("Angelo plans forests of at most %d trees (not %u), remove him from --hunters.\n", 
+				ANGELO_MAXTREES, *it);
+			return false;
+		}
+
+	return true;
+}
+
+
+
+/**
+ * [SweepSpec::build Evaluate the number of instances and trials of each size.]
+ * @param  S [Output sizes.]
+ * @return   [False if an expression is invalid or not positive.]
+ */
+bool SweepSpec::build( std::vector<SweepSize>& S ) const
+{
+	S.resize( sizes.size() );
+
+	for ( unsigned i = 0; i < sizes.size(); ++i )
+	{
+		double ni, nt;
+		if ( !evaluate_size_expression( instances.c_str(), sizes[i], ni ) || ni < 1.0 ||
+			!evaluate_size_expression( trials.c_str(), sizes[i], nt ) || nt < 1.0 )
+		{
+			printf("Invalid instances (%s) or trials (%s) for %u trees.\n", 
+				instances.c_str(), trials.c_str(), sizes[i]);
+			return false;
+		}
+
+		S[i].trees     = sizes[i];
+		S[i].instances = static_cast<unsigned>( ni + 0.5 );
+		S[i].trials    = static_cast<unsigned>( nt + 0.5 );
+	}
+
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [json_statistics Write a StreamingStatistics object (quantiles of integers if integral).]
+ */
+static void json_statistics( FILE *f, const char *name, const StreamingStatistics& S, const bool& integral = false )
+{
+	fprintf( f, "\"%s\": {\"count\": %lu, \"mean\": %.17g, \"std\": %.17g, \"min\": %.17g, \"max\": %.17g, "
+		"\"p50\": %.17g, \"p90\": %.17g, \"p99\": %.17g}", name, (unsigned long) S.size(), 
+		S.mean(), S.std(), S.size() ? S.min() : 0.0, S.size() ? S.max() : 0.0, 
+		S.quantile(0.5,integral), S.quantile(0.9,integral), S.quantile(0.99,integral) );
+}
+
+
+
+/**
+ * [write_json Write the results of a sweep as JSON.]
+ * @param  file    [Output file.]
+ * @param  B       [The benchmark that ran the sweep.]
+ * @param  sizes   [Sizes of the sweep.]
+ * @param  results    [Results of each size and hunter.]
+ * @param  plan_cache [Whether Angelo looked for his plans in a cache.]
+ * @return            [False if the file cannot be written.]
+ */
+bool write_json( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const bool& plan_cache )
+{
+	FILE *f = fopen( file, "w" );
+	if ( !f ) return false;
+
+	fprintf( f, "{\n  \"seed\": %llu,\n  \"generator\": \"%s\",\n  \"jumps\": \"%s\",\n  \"plan_cache\": %s,\n"
+		"  \"sizes\": [", (unsigned long long) B.get_seed(), generator_name( B.get_generator() ), 
+		jumps_name( B.get_jumps() ), plan_cache ? "true" : "false" );
+
+	for ( unsigned s = 0; s < sizes.size(); ++s )
+	{
+		fprintf( f, "%s\n    {\"trees\": %u, \"instances\": %u, \"trials\": %u, \"hunters\": [", 
+			s ? "," : "", sizes[s].trees, sizes[s].instances, sizes[s].trials );
+
+		for ( unsigned k = 0; k < results[s].size(); ++k )
+		{
+			const ResultsStatistics& R = results[s][k];
+
+			fprintf( f, "%s\n      {\"name\": \"%s\", \"samples\": %lu, \"success_ratio\": %.17g, "
+				"\"censored_ratio\": %.17g, \"shot_time\": %.17g,\n        ", k ? "," : "", 
+				B.hunter_name(k), (unsigned long) R.n_samples, R.success_ratio(), R.censored_ratio(), 
+				R.shot_time() );
+
+			json_statistics( f, "shots", R.shots, true );      fprintf( f, ",\n        " );
+			json_statistics( f, "hunt_time", R.time );   fprintf( f, ",\n        " );
+			json_statistics( f, "setup_time", R.setup ); fprintf( f, "}" );
+		}
+
+		fprintf( f, "\n    ]}" );
+	}
+
+	fprintf( f, "\n  ]\n}\n" );
+	return fclose(f) == 0;
+}
+
+
+
+/**
+ * [write_csv Write the results of a sweep as CSV (one line per size and hunter).]
+ * @param  file    [Output file.]
+ * @param  B       [The benchmark that ran the sweep.]
+ * @param  sizes   [Sizes of the sweep.]
+ * @param  results    [Results of each size and hunter.]
+ * @param  plan_cache [Whether Angelo looked for his plans in a cache.]
+ * @return            [False if the file cannot be written.]
+ */
+bool write_csv( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const bool& plan_cache )
+{
+	FILE *f = fopen( file, "w" );
+	if ( !f ) return false;
+
+	fprintf( f, "generator,jumps,plan_cache,trees,instances,trials,hunter,samples,success,censored,"
+		"shots_mean,shots_std,shots_p50,shots_p90,shots_p99,"
+		"time_mean,time_std,time_p50,time_p90,time_p99,setup_mean,setup_std,shot_time\n" );
+
+	for ( unsigned s = 0; s < sizes.size(); ++s )
+	for ( unsigned k = 0; k < results[s].size(); ++k )
+	{
+		const ResultsStatistics& R = results[s][k];
+
+		fprintf( f, "%s,%s,%d,%u,%u,%u,%s,%lu,%lu,%lu,", generator_name( B.get_generator() ), 
+			jumps_name( B.get_jumps() ), (int) plan_cache, sizes[s].trees, sizes[s].instances, sizes[s].trials, B.hunter_name(k), 
+			(unsigned long) R.n_samples, (unsigned long) R.n_success, (unsigned long) R.n_censored );
+
+		fprintf( f, "%.17g,%.17g,%.17g,%.17g,%.17g,", R.shots.mean(), R.shots.std(), 
+			R.shots.quantile(0.5,true), R.shots.quantile(0.9,true), R.shots.quantile(0.99,true) );
+		fprintf( f, "%.17g,%.17g,%.17g,%.17g,%.17g,", R.time.mean(), R.time.std(), 
+			R.time.quantile(0.5), R.time.quantile(0.9), R.time.quantile(0.99) );
+		fprintf( f, "%.17g,%.17g,%.17g\n", R.setup.mean(), R.setup.std(), R.shot_time() );
+	}
+
+	return fclose(f) == 0;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [normal_critical_value Upper alpha-quantile of the standard normal distribution (bisection).]
+ */
+static double normal_critical_value( const double& alpha )
+{
+	double lo = 0.0, hi = 40.0;
+	for ( unsigned i = 0; i < 100; ++i )
+	{
+		const double z = (lo+hi)/2;
+		if ( 0.5 * std::erfc( z / std::sqrt(2.0) ) > alpha ) lo = z; else hi = z;
+	}
+	return (lo+hi)/2;
+}
+
+
+
+/**
+ * [compare_baseline Flag significant increases of the means w.r.t. a previous run.]
+ * @param  file        [CSV results of the previous run.]
+ * @param  B           [The benchmark that ran the sweep.]
+ * @param  sizes       [Sizes of the sweep.]
+ * @param  results     [Results of each size and hunter.]
+ * @param  alpha       [Level of the one-sided tests.]
+ * @param  regressions [Output significant increases.]
+ * @return             [False if the baseline cannot be read.]
+ */
+bool compare_baseline( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const double& alpha, 
+	std::vector<Regression>& regressions )
+{
+	regressions.clear();
+
+	FILE *f = fopen( file, "r" );
+	if ( !f ) return false;
+
+	// Read lines
+	std::vector<std::string> lines; std::string line; int ch;
+	while ( (ch = fgetc(f)) != EOF ) 
+		if ( ch == '\n' ) { lines.push_back(line); line.clear(); } 
+		else if ( ch != '\r' ) line += (char) ch;
+	if ( !line.empty() ) lines.push_back(line);
+	fclose(f);
+
+	if ( lines.empty() ) return false;
+
+	// Find columns by name
+	const std::vector<std::string> header = split( lines[0], ',' );
+	const char *names[] = { "generator", "trees", "hunter", "success", 
+		"shots_mean", "shots_std", "time_mean", "time_std" };
+	int col[8];
+
+	for ( unsigned c = 0; c < 8; ++c )
+	{
+		col[c] = std::find( header.begin(), header.end(), names[c] ) - header.begin();
+		if ( col[c] == (int) header.size() ) return false;
+	}
+
+	// Older baselines have no jumps column, and were run with uniform jumps
+	const int col_jumps = std::find( header.begin(), header.end(), "jumps" ) - header.begin();
+
+	const double z_crit = normal_critical_value( alpha );
+	const char *metrics[] = { "shots", "time" };
+
+	for ( unsigned l = 1; l < lines.size(); ++l )
+	{
+		const std::vector<std::string> row = split( lines[l], ',' );
+		if ( row.size() != header.size() || row[col[0]] != generator_name( B.get_generator() ) ) continue;
+		if ( (col_jumps < (int) header.size() ? row[col_jumps] : "uniform") != jumps_name( B.get_jumps() ) ) continue;
+
+		const unsigned trees = std::strtoul( row[col[1]].c_str(), nullptr, 10 );
+		const double n_old = std::strtod( row[col[3]].c_str(), nullptr );
+
+		// Find the same size and hunter in the current run
+		for ( unsigned s = 0; s < sizes.size(); ++s ) if ( sizes[s].trees == trees )
+		for ( unsigned k = 0; k < results[s].size(); ++k ) if ( row[col[2]] == B.hunter_name(k) )
+		{
+			const ResultsStatistics& R = results[s][k];
+			const double n_new = R.n_success;
+			if ( n_old < 2 || n_new < 2 ) continue;
+
+			for ( unsigned m = 0; m < 2; ++m )
+			{
+				const StreamingStatistics& S = m ? R.time : R.shots;
+				const double mu_old = std::strtod( row[col[4+2*m]].c_str(), nullptr );
+				const double sd_old = std::strtod( row[col[5+2*m]].c_str(), nullptr );
+
+				// Welch statistic
+				const double se = std::sqrt( sd_old*sd_old/n_old + S.variance()/n_new );
+				const double z  = se > 0.0 ? (S.mean() - mu_old) / se : 0.0;
+
+				if ( z > z_crit )
+				{
+					Regression r = { trees, B.hunter_name(k), metrics[m], mu_old, S.mean(), z };
+					regressions.push_back(r);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
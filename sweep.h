@@ -0,0 +1,161 @@
+#ifndef __SWEEP__
+#define __SWEEP__
+
+//=============================================
+// @filename     sweep.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "benchmark.h"
+
+#define SWEEP_ALPHA 0.01
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Evaluate an arithmetic expression of the number of trees n, e.g. "n^2", "4*n" or "100".
+ * Supports integers, n, + - * / ^ and parentheses.
+ */
+bool evaluate_size_expression( const char* expr, const double& n, double& value );
+
+
+
+/**
+ * Specification of a sweep, usually parsed from the command line:
+ *
+ *   --sizes 6:21[:step] | 6,8,12    Numbers of trees (at most ANGELO_MAXTREES with Angelo)
+ *   --instances EXPR                Forests per size, expression of n (default n^2)
+ *   --trials EXPR                   Trials per forest, expression of n (default n)
+ *   --generator cur|tree            Random graph model of the forests
+ *   --jumps uniform|random|degree   Law of Bob's jumps (see JumpModel)
+ *   --hunters NAME,NAME             Registered hunters to run
+ *   --seed S                        Seed of the benchmark (random by default)
+ *   --shots N, --seconds T          Budget of each hunter in each trial (0 for unlimited)
+ *   --threads K                     Number of threads (0 for all cores)
+ *   --json FILE, --csv FILE         Machine-readable results
+ *   --baseline FILE [--alpha A]     Compare against the CSV results of a previous run
+ *   --no-analysis                   Skip plan verification, evaluation and comparison
+ *   --counters                      Count hardware events in each phase (Linux only)
+ *   --ci-shots R, --ci-time R       Target relative half-widths of the 95% intervals
+ *   --ci-success A                  Target absolute half-width for the success ratio
+ *   --max-instances N               Hard cap on the instances of each size
+ *   --stratified                    Start the trials of a forest on all trees in turn
+ *   --checkpoint FILE [--every T]   Save progress every T seconds, resume from FILE
+ *   --shard I/K --partial FILE      Run the I-th of K shards (0-based), write results to FILE
+ *   --merge FILE,FILE               Combine the partial files of all shards (same options)
+ *   --plan-cache FILE               Share Angelo's plans with other runs through FILE (off by default)
+ *
+ * With a target precision, the number of instances is the initial one for each size.
+ */
+struct SweepSpec
+{
+	std::vector<unsigned> sizes;
+	std::string instances, trials;
+	ForestGenerator generator;
+	JumpModel jumps;
+	std::vector<std::string> hunters;
+
+	bool has_seed; uint64_t seed;
+	unsigned max_shots, threads;
+	double max_seconds, alpha;
+	bool analyses, counters, stratified;
+	SweepPrecision precision;
+
+	std::string json_file, csv_file, baseline_file, checkpoint_file, plan_cache_file;
+	double checkpoint_period;
+
+	unsigned shard_index, shard_count;
+	std::string partial_file;
+	std::vector<std::string> merge_files;
+
+	// Ctor
+	SweepSpec() { defaults(); }
+
+	// Default sweep (sizes 6 to 21, n^2 instances, n trials)
+	void defaults();
+
+	// Parse command-line arguments (returns false on error or --help)
+	bool parse( int argc, char **argv );
+
+	// Sizes of the sweep
+	bool build( std::vector<SweepSize>& S ) const;
+
+	// Print usage on stdout
+	static void usage( const char *program );
+};
+
+
+
+/**
+ * Name of a random graph model in the outputs.
+ */
+const char* generator_name( const ForestGenerator& generator );
+
+
+
+/**
+ * Name of a law of jumps in the outputs.
+ */
+const char* jumps_name( const JumpModel& jumps );
+
+
+
+/**
+ * Write the results of a sweep, for each size and hunter of the benchmark.
+ * CSV files have one line per (size, hunter) and can be used as baselines. Both record 
+ * whether Angelo's plans came from a cache, which shortens his setup times.
+ */
+bool write_json( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const bool& plan_cache );
+
+bool write_csv( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const bool& plan_cache );
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Significant increase of a mean (shots or hunt time) with respect to a baseline.
+ */
+struct Regression
+{
+	unsigned trees;
+	std::string hunter, metric;
+	double baseline, current, z;
+};
+
+
+
+/**
+ * Compare the results of a sweep with the CSV results of a previous run.
+ * The means of shots and hunt times of each (size, hunter) found in both runs are 
+ * compared with a one-sided Welch test at level alpha (normal approximation, samples
+ * are large); sizes and hunters missing in the baseline are ignored.
+ * Returns false if the baseline cannot be read.
+ */
+bool compare_baseline( const char *file, const Benchmark& B, const std::vector<SweepSize>& sizes, 
+	const std::vector< std::vector<ResultsStatistics> >& results, const double& alpha, 
+	std::vector<Regression>& regressions );
+
+#endif
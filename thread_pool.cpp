@@ -0,0 +1,117 @@
+#include "thread_pool.h"
+
+//=============================================
+// @filename     thread_pool.cpp
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * [WorkStealingPool::WorkStealingPool Create the queues of the workers.]
+ * @param threads [Number of workers (0 for one per hardware thread).]
+ */
+WorkStealingPool::WorkStealingPool( unsigned threads )
+{
+	if ( threads == 0 ) threads = std::thread::hardware_concurrency();
+	n_workers = threads ? threads : 1;
+
+	for ( unsigned w = 0; w < n_workers; ++w ) 
+		queues.push_back( std::unique_ptr<Queue>( new Queue ) );
+}
+
+
+
+/**
+ * [WorkStealingPool::run Run all tasks and wait for completion.]
+ * The calling thread acts as the first worker.
+ * @param n_tasks [Number of tasks.]
+ * @param task    [Function to call with each task index.]
+ */
+void WorkStealingPool::run( const unsigned& n_tasks, const task_type& task )
+{
+	// Deal contiguous blocks of tasks
+	for ( unsigned w = 0, t = 0; w < n_workers; ++w )
+	{
+		const unsigned last = (unsigned) ( (uint64_t) n_tasks * (w+1) / n_workers );
+
+		queues[w]->tasks.clear();
+		for ( ; t < last; ++t ) queues[w]->tasks.push_back(t);
+	}
+
+	// Start workers
+	std::vector<std::thread> threads;
+	for ( unsigned w = 1; w < n_workers; ++w ) 
+		threads.push_back( std::thread( &WorkStealingPool::work, this, w, std::cref(task) ) );
+
+	work( 0, task );
+
+	// Wait for completion
+	for ( auto t = threads.begin(); t != threads.end(); ++t ) t->join();
+}
+
+
+
+/**
+ * [WorkStealingPool::work Run tasks until there are none left.]
+ * @param worker [Index of the worker.]
+ * @param task   [Function to call with each task index.]
+ */
+void WorkStealingPool::work( const unsigned& worker, const task_type& task )
+{
+	unsigned t;
+	while ( next(worker,t) ) task( t, worker );
+}
+
+
+
+/**
+ * [WorkStealingPool::next Pop a task from our own queue, or steal one.]
+ * @param  worker [Index of the worker.]
+ * @param  task   [Output task index.]
+ * @return        [False if all queues are empty.]
+ */
+bool WorkStealingPool::next( const unsigned& worker, unsigned& task )
+{
+	// Own queue first
+	{
+		Queue& q = *queues[worker];
+		std::lock_guard<std::mutex> guard(q.lock);
+
+		if ( !q.tasks.empty() )
+		{
+			task = q.tasks.front(); q.tasks.pop_front();
+			return true;
+		}
+	}
+
+	// Steal from the back of the others
+	for ( unsigned k = 1; k < n_workers; ++k )
+	{
+		Queue& q = *queues[ (worker+k) % n_workers ];
+		std::lock_guard<std::mutex> guard(q.lock);
+
+		if ( !q.tasks.empty() )
+		{
+			task = q.tasks.back(); q.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Nothing left (tasks are never added while running)
+	return false;
+}
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
@@ -0,0 +1,72 @@
+#ifndef __THREAD_POOL__
+#define __THREAD_POOL__
+
+//=============================================
+// @filename     thread_pool.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <functional>
+
+
+
+	/********************     **********     ********************/
+	/********************     **********     ********************/
+
+
+
+/**
+ * Run a batch of indexed tasks on several threads with work stealing.
+ *
+ * Tasks are dealt in contiguous blocks to the workers' deques. Each worker pops tasks 
+ * from the front of its own deque, and when it is empty, steals from the back of the 
+ * other deques. This balances tasks of very different costs (e.g. forests of different
+ * sizes) without a central queue.
+ */
+class WorkStealingPool
+{
+public:
+
+	// Task: (task index, worker index)
+	typedef std::function<void( const unsigned&, const unsigned& )> task_type;
+
+	// Ctor (0 threads means one per hardware thread)
+	explicit WorkStealingPool( unsigned threads = 0 );
+
+	// Number of workers
+	inline unsigned size() const { return n_workers; }
+
+	// Run tasks 0..n_tasks-1 and wait for all of them to complete
+	void run( const unsigned& n_tasks, const task_type& task );
+
+private:
+
+	struct Queue
+	{
+		std::mutex lock;
+		std::deque<unsigned> tasks;
+	};
+
+	// Worker loop
+	void work( const unsigned& worker, const task_type& task );
+
+	// Get next task for this worker, false if there are none left anywhere
+	bool next( const unsigned& worker, unsigned& task );
+
+	// Members
+	// 
+	std::vector< std::unique_ptr<Queue> > queues;
+	unsigned n_workers;
+};
+
+#endif
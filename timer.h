@@ -0,0 +1,65 @@
+#ifndef __TIMER__
+#define __TIMER__
+
+//=============================================
+// @filename     timer.h
+// @date         April 1st 2013
+// @author       Jonathan H. (Sheljohn on Github)
+// @contact      ariel .dot hadida [at] gmail
+// @license      Creative Commons by-nc-sa 3.0 
+//               http://creativecommons.org/licenses/by-nc-sa/3.0/
+//=============================================
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+
+
+/**
+ * Wall-clock stopwatch on the steady clock, with the cost of reading the clock subtracted.
+ * The overhead is calibrated once (median of back-to-back readings), and timed sections 
+ * should be long enough (batches of shots rather than single shots) for it to be small.
+ */
+class Stopwatch
+{
+public:
+
+	typedef std::chrono::steady_clock clock_type;
+
+	// Start timing
+	inline void start() { t0 = clock_type::now(); }
+
+	// Elapsed time in seconds since start, without the measurement overhead
+	inline double stop() const 
+	{ 
+		const double t = std::chrono::duration<double>( clock_type::now() - t0 ).count() - overhead();
+		return t > 0.0 ? t : 0.0;
+	}
+
+	// Time in seconds spent reading the clock in a start/stop pair
+	static double overhead()
+	{
+		static const double calibrated = calibrate();
+		return calibrated;
+	}
+
+private:
+
+	static double calibrate()
+	{
+		std::vector<double> samples(1001);
+		for ( auto s = samples.begin(); s != samples.end(); ++s )
+		{
+			const clock_type::time_point a = clock_type::now();
+			*s = std::chrono::duration<double>( clock_type::now() - a ).count();
+		}
+
+		std::nth_element( samples.begin(), samples.begin() + 500, samples.end() );
+		return samples[500];
+	}
+
+	clock_type::time_point t0;
+};
+
+#endif